@@ -0,0 +1,50 @@
+#!/bin/sh
+# Batch mode throughput: lines per second for a generated script run
+# through "-s script", through piped stdin, and interactively on a pty
+# (via script(1)). Run with "make bench-batch" or
+#   bench/batch.sh [lines]
+# Interactive runs need getlogin() to work on the pty; where it does not
+# (containers without utmp) that row is reported as skipped.
+
+SHELL_OUT=${SHELL_OUT:-./shell.out}
+LINES=${1:-200000}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+# builtin: prompt and parse work only; external: one spawn per line
+awk -v n="$LINES" 'BEGIN { for (i = 0; i < n; i++) print "hop ." }' > "$WORK/builtin.sh"
+awk -v n="$((LINES / 100))" 'BEGIN { for (i = 0; i < n; i++) print "true" }' > "$WORK/external.sh"
+
+now() {
+    date +%s.%N
+}
+
+rate() {
+    # rate <lines> <start> <end>
+    echo "$1 $2 $3" | awk '{ printf "%10.0f lines/s  (%d lines, %.3f s)\n", $1 / ($3 - $2), $1, $3 - $2 }'
+}
+
+run() {
+    # run <label> <script> <mode>
+    count=$(wc -l < "$2")
+    start=$(now)
+    case $3 in
+        script) "$SHELL_OUT" -s "$2" > /dev/null 2>&1 ;;
+        pipe) "$SHELL_OUT" < "$2" > /dev/null 2>&1 ;;
+        tty) script -qec "$SHELL_OUT" /dev/null < "$2" > "$WORK/tty.out" 2>&1 ;;
+    esac
+    end=$(now)
+    if [ "$3" = tty ] && grep -q "getlogin() error" "$WORK/tty.out"; then
+        printf "%-22s skipped (getlogin fails on this pty)\n" "$1"
+        return
+    fi
+    printf "%-22s " "$1"
+    rate "$count" "$start" "$end"
+}
+
+run "builtin -s" "$WORK/builtin.sh" script
+run "builtin pipe" "$WORK/builtin.sh" pipe
+run "builtin interactive" "$WORK/builtin.sh" tty
+run "external -s" "$WORK/external.sh" script
+run "external pipe" "$WORK/external.sh" pipe
+run "external interactive" "$WORK/external.sh" tty
@@ -0,0 +1,28 @@
+#!/bin/sh
+# Job table stress: start many concurrent background jobs, then time
+# repeated "bg 1" (the oldest job, the far end of any list walk) while
+# they are all alive. Run with "make bench-jobs" or
+#   bench/jobs.sh [jobs] [lookups]
+# The shell kills the remaining jobs when the script ends.
+
+SHELL_OUT=${SHELL_OUT:-./shell.out}
+JOBS=${1:-10000}
+LOOKUPS=${2:-20000}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+# date(1) brackets the lookup phase so job start-up is not counted
+awk -v jobs="$JOBS" -v lookups="$LOOKUPS" -v stamps="$WORK/stamps" 'BEGIN {
+    for (i = 0; i < jobs; i++) print "sleep 60 &"
+    print "date +%s.%N >> " stamps
+    for (i = 0; i < lookups; i++) print "bg 1"
+    print "date +%s.%N >> " stamps
+}' > "$WORK/jobs.sh"
+
+"$SHELL_OUT" -s "$WORK/jobs.sh" > "$WORK/out" 2>&1
+
+started=$(grep -c '^\[[0-9]*\] [0-9]*$' "$WORK/out")
+awk -v jobs="$started" -v lookups="$LOOKUPS" '
+    NR == 1 { start = $1 }
+    NR == 2 { printf "%d jobs, %d x bg 1: %.3f s (%.2f us per lookup)\n", jobs, lookups, $1 - start, ($1 - start) * 1e6 / lookups }
+' "$WORK/stamps"
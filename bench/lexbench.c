@@ -0,0 +1,135 @@
+#include "../include/parser.h"
+#include "../include/lexer.h"
+#include <time.h>
+
+/*
+    Lexer throughput: the legacy tokenize* chain plus checkShellCmd (four
+    passes, malloc per node) against lexShellCommand (one pass into an
+    arena) on the same generated command lines of growing length. Both
+    must agree on validity. Run with "make bench-lex".
+*/
+
+#define TARGET_NANOS 200000000.0 // time spent per input and parser, roughly
+
+// Valid fragments, each followed by its own separator when another comes after
+static const char* fragments[] = {
+    "ls -la src | grep lexer > out.txt",
+    "cat < in.txt | sort | uniq -c >> counts.txt",
+    "sleep 1",
+    "hop .. ; reveal -la ~",
+    "echo one two three | wc -w",
+};
+static const char* separators[] = { " ; ", " ; ", " & ", " ; ", " ; " };
+
+static char* buildLine(size_t target){
+    char* line = (char*)malloc(target + 128);
+    if (line == NULL) {
+        perror("malloc failed");
+        exit(1);
+    }
+    size_t length = 0;
+    int count = sizeof(fragments) / sizeof(fragments[0]);
+    for (int i = 0; length < target; i++) {
+        const char* fragment = fragments[i % count];
+        if (i > 0) {
+            memcpy(line + length, separators[(i - 1) % count], 3);
+            length += 3;
+        }
+        size_t fragmentLength = strlen(fragment);
+        memcpy(line + length, fragment, fragmentLength);
+        length += fragmentLength;
+    }
+    line[length] = '\0';
+    return line;
+}
+
+static double nowNanos(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+// The chain verifyCommand ran before the lexer
+static bool legacyParse(char* line){
+    struct shell_cmd* shellResult = tokenizeShellCommand(line);
+    if (shellResult == NULL) return false;
+    for (int i = 0; i < shellResult->cmdArrIndex; i++) {
+        struct cmd_group* cmdGroup = tokenizeCmdGroup(shellResult->cmdGroupArr[i]);
+        if (cmdGroup == NULL) break;
+        shellResult->cmdGroupArr[i] = cmdGroup;
+        for (int j = 0; j < cmdGroup->atomicArrIndex; j++) {
+            struct atomic* atomicResult = tokenizeAtomic(cmdGroup->atomicArr[j]);
+            if (atomicResult == NULL) break;
+            cmdGroup->atomicArr[j] = atomicResult;
+            for (int k = 0; k < atomicResult->termArrIndex; k++) {
+                struct terminal* terminalResult = tokenizeTerminal(atomicResult->terminalArr[k]);
+                if (terminalResult == NULL) break;
+                atomicResult->terminalArr[k] = terminalResult;
+            }
+        }
+    }
+    bool valid = checkShellCmd(shellResult);
+    freeShellCmd(shellResult);
+    return valid;
+}
+
+static struct arena benchArena;
+
+static bool lexerParse(char* line){
+    struct shell_cmd* shellResult = lexShellCommand(line, &benchArena);
+    bool valid = shellResult != NULL && shellResult->validity;
+    arenaReset(&benchArena);
+    return valid;
+}
+
+// Mean nanoseconds per parse of line; *valid gets the parser's verdict
+static double timeParser(bool (*parse)(char*), const char* line, bool* valid){
+    size_t length = strlen(line);
+    char* copy = (char*)malloc(length + 1);
+    if (copy == NULL) {
+        perror("malloc failed");
+        exit(1);
+    }
+    // Calibrate on one run, then repeat for about TARGET_NANOS
+    memcpy(copy, line, length + 1);
+    double start = nowNanos();
+    *valid = parse(copy);
+    double once = nowNanos() - start;
+    long rounds = (once > 0) ? (long)(TARGET_NANOS / once) : 1000;
+    if (rounds < 3) rounds = 3;
+
+    start = nowNanos();
+    for (long i = 0; i < rounds; i++) {
+        memcpy(copy, line, length + 1); // the tokenizers may write into their input
+        parse(copy);
+    }
+    double mean = (nowNanos() - start) / rounds;
+    free(copy);
+    return mean;
+}
+
+int main(int argc, char** argv){
+    static const size_t lengths[] = { 40, 500, 4000, 32000 };
+    arenaInit(&benchArena, 0);
+    printf("%8s  %12s  %12s  %10s  %8s\n", "bytes", "chain us", "lexer us", "lexer MB/s", "speedup");
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        char* line = buildLine(lengths[i]);
+        bool legacyValid, lexerValid;
+        double legacy = timeParser(legacyParse, line, &legacyValid);
+        double lexer = timeParser(lexerParse, line, &lexerValid);
+        if (legacyValid != lexerValid) {
+            fprintf(stderr, "lexbench: parsers disagree on a %zu byte line\n", strlen(line));
+            return 1;
+        }
+        if (!lexerValid) {
+            fprintf(stderr, "lexbench: generated %zu byte line is invalid\n", strlen(line));
+            return 1;
+        }
+        size_t length = strlen(line);
+        printf("%8zu  %12.2f  %12.2f  %10.1f  %7.1fx\n", length, legacy / 1e3, lexer / 1e3,
+               length / (lexer / 1e9) / 1e6, legacy / lexer);
+        free(line);
+    }
+    arenaDestroy(&benchArena);
+    return 0;
+}
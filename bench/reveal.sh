@@ -0,0 +1,35 @@
+#!/bin/sh
+# reveal on huge directories: builds directories of the given sizes
+# (default 100k and 1M empty files) and times "reveal -a <dir>" inside
+# the shell, best of three runs. Run with "make bench-reveal" or
+#   bench/reveal.sh [entries...]
+# Directories are built under $TMPDIR and removed afterwards.
+
+SHELL_OUT=${SHELL_OUT:-./shell.out}
+[ $# -gt 0 ] || set -- 100000 1000000
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+for entries in "$@"; do
+    dir="$WORK/dir$entries"
+    mkdir "$dir"
+    (cd "$dir" && seq -f "entry%.0f" 1 "$entries" | xargs touch)
+
+    # date(1) brackets each listing so shell start-up is not counted
+    awk -v dir="$dir" -v stamps="$WORK/stamps" 'BEGIN {
+        for (i = 0; i < 3; i++) {
+            print "date +%s.%N >> " stamps
+            print "reveal -a " dir " > /dev/null"
+            print "date +%s.%N >> " stamps
+        }
+    }' > "$WORK/reveal.sh"
+    : > "$WORK/stamps"
+    "$SHELL_OUT" -s "$WORK/reveal.sh" > /dev/null
+
+    awk -v entries="$entries" '
+        NR % 2 == 1 { start = $1 }
+        NR % 2 == 0 { if (best == "" || $1 - start < best) best = $1 - start }
+        END { printf "%8d entries: reveal -a %.3f s (best of %d)\n", entries, best, NR / 2 }
+    ' "$WORK/stamps"
+    rm -rf "$dir"
+done
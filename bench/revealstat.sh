@@ -0,0 +1,53 @@
+#!/bin/sh
+# reveal -l latency, parallel statx pool against sequential stat: times
+# "reveal -l <dir>" on a directory of 100k files (or the given size)
+# with the normal shell and with a REVEAL_STAT_THREADS=1 build, best of
+# three runs each. Warm runs always; cold runs too when the page cache
+# can be dropped (root). Run with "make bench-statx" or
+#   bench/revealstat.sh [entries]
+
+SHELL_OUT=${SHELL_OUT:-./shell.out}
+SEQ_OUT=${SEQ_OUT:-./bench/seqstat.out}
+ENTRIES=${1:-100000}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+dir="$WORK/dir"
+mkdir "$dir"
+(cd "$dir" && seq -f "entry%.0f" 1 "$ENTRIES" | xargs touch)
+
+canDrop=0
+if [ -w /proc/sys/vm/drop_caches ]; then
+    canDrop=1
+fi
+
+# time_listing <label> <shell> <cold>: date(1) brackets each listing inside the shell
+time_listing() {
+    : > "$WORK/stamps"
+    for run in 1 2 3; do
+        if [ "$3" = 1 ]; then
+            sync
+            echo 3 > /proc/sys/vm/drop_caches
+        fi
+        printf 'date +%%s.%%N >> %s\nreveal -l %s > /dev/null\ndate +%%s.%%N >> %s\n' \
+            "$WORK/stamps" "$dir" "$WORK/stamps" > "$WORK/reveal.sh"
+        "$2" -s "$WORK/reveal.sh" > /dev/null
+    done
+    awk -v label="$1" -v entries="$ENTRIES" '
+        NR % 2 == 1 { start = $1 }
+        NR % 2 == 0 { if (best == "" || $1 - start < best) best = $1 - start }
+        END { printf "%-28s %d files: %.3f s (best of %d)\n", label, entries, best, NR / 2 }
+    ' "$WORK/stamps"
+}
+
+# Warm the cache once so the first warm run is not a cold one
+ls -l "$dir" > /dev/null
+
+time_listing "warm, parallel statx" "$SHELL_OUT" 0
+time_listing "warm, sequential" "$SEQ_OUT" 0
+if [ $canDrop = 1 ]; then
+    time_listing "cold, parallel statx" "$SHELL_OUT" 1
+    time_listing "cold, sequential" "$SEQ_OUT" 1
+else
+    echo "cold runs skipped (cannot write /proc/sys/vm/drop_caches)"
+fi
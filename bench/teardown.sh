@@ -0,0 +1,30 @@
+#!/bin/sh
+# Teardown stress: start thousands of background pipelines and single
+# jobs from a -s script, let the shell hit EOF, then count the processes
+# that outlived it. Run with "make bench-teardown" or
+#   bench/teardown.sh [pipelines] [jobs]
+# Exits non-zero if anything survived.
+
+SHELL_OUT=${SHELL_OUT:-./shell.out}
+PIPELINES=${1:-2000}
+JOBS=${2:-2000}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+# Unusual durations so only this run's sleeps are counted
+awk -v pipelines="$PIPELINES" -v jobs="$JOBS" 'BEGIN {
+    for (i = 0; i < pipelines; i++) print "sleep 1000 | sleep 1000 &"
+    for (i = 0; i < jobs; i++) print "sleep 1001 &"
+}' > "$WORK/jobs.sh"
+
+start=$(date +%s.%N)
+"$SHELL_OUT" -s "$WORK/jobs.sh" > /dev/null 2>&1
+end=$(date +%s.%N)
+sleep 1
+
+left=$(pgrep -c -f '^sleep 100[01]$')
+echo "$PIPELINES pipelines + $JOBS jobs, run and torn down in $(echo "$start $end" | awk '{ printf "%.2f", $2 - $1 }') s; sleeps left after EOF: $left"
+if [ "$left" -ne 0 ]; then
+    pkill -f '^sleep 100[01]$'
+    exit 1
+fi
@@ -0,0 +1,50 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string.h>
+#include <stdbool.h>
+
+#define ARENA_CHUNK_SIZE 16384 // default chunk size, bigger requests get their own chunk
+
+struct arena_chunk{
+    struct arena_chunk* next;
+    size_t size;  // usable bytes in data[]
+    size_t used;
+    char data[];
+};
+
+struct arena{
+    struct arena_chunk* head;    // first chunk, kept across resets
+    struct arena_chunk* current; // chunk allocations are served from
+    size_t chunkSize;
+    void* lastAlloc;             // most recent allocation, can be grown in place
+
+    // Counters (cumulative since arenaInit)
+    unsigned long allocCount;  // allocations served from the arena
+    unsigned long mallocCount; // chunks obtained from malloc
+    unsigned long resetCount;  // number of arenaReset calls (one per command)
+    size_t bytesInUse;         // bytes handed out since the last reset
+    size_t highWater;          // largest bytesInUse seen before a reset
+};
+
+void arenaInit(struct arena* arena, size_t chunkSize);
+
+// Pointer-aligned allocation. Returns NULL only when malloc fails.
+void* arenaAlloc(struct arena* arena, size_t size);
+
+void* arenaCalloc(struct arena* arena, size_t size);
+
+// Grow an allocation; extends in place when ptr is the most recent allocation
+void* arenaRealloc(struct arena* arena, void* ptr, size_t oldSize, size_t newSize);
+
+char* arenaStrndup(struct arena* arena, const char* src, size_t length);
+
+// Release everything at once in O(1); chunks are kept and reused
+void arenaReset(struct arena* arena);
+
+void arenaDestroy(struct arena* arena);
+
+#endif // ARENA_H
\ No newline at end of file
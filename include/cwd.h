@@ -0,0 +1,38 @@
+#ifndef CWD_H
+#define CWD_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+/*
+    The shell's working directory as a string, so that hop, reveal and the
+    prompt never have to ask the kernel for it. It is read with getcwd once
+    at startup and from then on updated by cwdChange along with each chdir.
+
+    The string is always the canonical path, as getcwd would return it, so
+    ".." can be resolved by dropping the last component. A named component
+    is appended after an lstat confirms it is a real directory rather than
+    a symlink; a path that does pass through a symlink falls back to one
+    getcwd. Targets already known to be canonical (home, OLDPWD) are taken
+    as they are.
+*/
+
+extern char* currentWD;              // canonical path of the working directory
+extern unsigned long cwdGeneration; // bumped on every change, for caches derived from currentWD
+
+// getcwd once; false if the working directory cannot be determined
+bool cwdInit(void);
+
+// chdir to target and update currentWD. Returns the previous currentWD, which the
+// caller now owns, or NULL (nothing changed) if the chdir failed.
+char* cwdChange(const char* target, bool canonical);
+
+// Canonical parent of currentWD, as a new string
+char* cwdParent(void);
+
+#endif // CWD_H
\ No newline at end of file
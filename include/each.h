@@ -0,0 +1,34 @@
+#ifndef EACH_H
+#define EACH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include <unistd.h>
+#include <sys/types.h>
+
+#include "plan.h"
+#include "spawn.h"
+
+#define EACH_READ_SIZE 65536 // bytes read from stdin at a time
+#define EACH_MAX_JOBS 256    // upper bound for -P
+
+/*
+    "each [-P jobs] [-n items] cmd [args...]": run cmd once for every line of
+    stdin (empty lines skipped), with the line appended to the stage's own
+    argv, like xargs -P jobs -n items -d '\n'. Up to jobs commands (default:
+    online cores) run at once; as soon as one exits the next one is started.
+    Commands are spawned straight into the current process group with stdin
+    from /dev/null, so the whole map is one job for Ctrl-C, Ctrl-Z, fg and bg.
+
+    Exit status is 0, 123 if any command failed, or 127 if cmd is not found.
+*/
+
+// ownJob: the shell itself is running the builtin; a leader is forked into a process
+// group of its own and its pid returned for the caller to wait on. Otherwise (pipeline
+// stage, background job) the map runs right here, and 0 is returned. -1 on error.
+pid_t executeEach(int argc, char** argv, bool ownJob);
+
+#endif // EACH_H
\ No newline at end of file
@@ -4,6 +4,14 @@
 #include "parser.h"
 #include "partB.h"
 #include "partE.h"
+#include "parsecache.h"
+#include "plan.h"
+#include "spawn.h"
+#include "reaper.h"
+#include "parallel.h"
+#include "each.h"
+#include "zygote.h"
+#include "stats.h"
 
 #include <sys/wait.h>
 #include <fcntl.h>
@@ -13,37 +21,39 @@ extern pid_t mainPid;
 extern int bg_fork; // Global variable to indicate background process
 extern int pipe_exists;
 
-#define MAX_BG_JOBS 100  // no longer a hard storage cap; kept for legacy semantics
+// Process group of the background job this process is running, for its pipeline stages
+extern pid_t current_job_pgid;
 
-struct bg_job {
-    int job_num;            // monotonically increasing ID
-    pid_t pid;              // process ID
-    char* cmd_name;         // duplicated command string
-    int status;             // 0 running, 1 exited normally, 2 exited abnormally (used transiently)
-    struct bg_job* next;    // singly-linked list
-};
+// Exit status (0-255) of the last foreground command or pipeline, as $? would hold it
+extern int lastExitStatus;
 
-extern struct bg_job* bg_job_head;
-extern int next_job_num;
+int exitStatusOf(int status);
 
-// Add a background job; returns the assigned job number or -1 on failure.
-int add_bg_job(pid_t pid, char* cmd_name);
+// Called once the foreground job is running and before the shell blocks on it;
+// must not touch stdin or the terminal (batch mode uses it to parse ahead)
+extern void (*foregroundWaitHook)(void);
+
+// Print exit messages for background jobs that have ended (collected by the reaper)
 void check_bg_jobs();
+// Reaper callback for a child that is not being waited on in the foreground
+void jobStatusChanged(pid_t pid, int status);
+int jobNotificationsPending(void);
 void print_bg_job_status(int job_num, pid_t pid, char* cmd_name, int status);
 
-// Helper to let other modules know if a PID corresponds to a still-running
-// background job tracked by the bg_jobs array (status == 0).
+// Helper to let other modules know if a PID corresponds to a live job in the job table
 int is_bg_job_running(pid_t pid);
 
-void executeShellCommand(struct shell_cmd* shellCommandStruct);
+// Run a compiled plan (see plan.h); the plan is never modified
+void executeShellCommand(const struct plan* plan);
 
-void executeCmdGroup(struct cmd_group* cmdGroupStruct);
+// cmdGroupStruct is a group node, its stage nodes follow it in the plan
+void executeCmdGroup(const struct plan_node* cmdGroupStruct);
 
-void executeAtomicCmd(struct atomic* atomicCmdStruct);
+void executeAtomicCmd(const struct plan_node* atomicCmdStruct);
 
-void executeActivities(struct atomic* atomicCmdStruct);
+void executeActivities(int argc, char** args);
 
-void executePing(struct atomic* atomicCmdStruct);
+void executePing(int argc, char** args);
 
 // Kill all known child jobs/process groups (used on EOF/Ctrl-D)
 void kill_all_children(void);
@@ -0,0 +1,36 @@
+#ifndef HISTINDEX_H
+#define HISTINDEX_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define HISTORY_INDEX_MIN_BUCKETS 1024   // power of two, doubled past 70% load
+#define HISTORY_INDEX_PENDING_WINDOW 64  // uncommitted entries this close to head are retried later
+
+/*
+    Trigram index over the history store for "log search". Each distinct
+    3-byte substring maps to the ascending list of entries (sequence numbers,
+    as offsets from indexBase) containing it. The index is built on the first
+    search and, on each later one, catches up with whatever this or any other
+    shell appended since. The store drops its oldest entries first, so
+    dropped or purged entries are always at the front of a list and are
+    skipped by moving its start offset; shells that never search pay nothing.
+*/
+
+struct gram_postings{
+    uint32_t key;   // trigram | HISTORY_GRAM_USED, 0 for an empty bucket
+    uint32_t start; // first live id
+    uint32_t len;
+    uint32_t cap;
+    uint32_t* ids;
+};
+
+void historyIndexClear(void);
+
+// log search <substring>: print matching entries, oldest first, with their log execute index
+void executeLogSearch(const char* needle);
+
+#endif // HISTINDEX_H
\ No newline at end of file
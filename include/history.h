@@ -0,0 +1,149 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include <stdint.h>
+
+#include <unistd.h>
+#include <sys/types.h>
+
+#define HISTORY_FILE_NAME ".cshell_history" // hidden, so plain reveal of the home skips it
+#define HISTORY_LEGACY_FILE_NAME "logs.txt" // text history, imported when a store is first created
+#define HISTORY_USAGE_FILE_NAME ".cshell_history.usage" // resource usage of entries, see usage.h
+#define HISTORY_MAGIC 0x31545348u           // "HST1"
+#define HISTORY_HEADER_SIZE 4096            // one page, so the slots can be mapped on their own
+#define HISTORY_SLOT_SIZE 512
+#define HISTORY_TEXT_SIZE (HISTORY_SLOT_SIZE - 16) // longest command kept in its slot
+#define HISTORY_LONG_MIN_SIZE (64 * 1024)   // smallest overflow area for longer commands
+#define HISTORY_FSYNC_SECONDS 1             // HISTORY_SYNC_PERIODIC: at most one fdatasync per interval
+#define HISTORY_MAX_CAPACITY (1 << 24)      // upper bound for HISTSIZE
+#define HISTORY_NO_SEQ UINT64_MAX           // no entry
+
+/*
+    The history store: <home>/.cshell_history, shared by every shell started in
+    that home directory. A header page holds the slot count and the head
+    (the next sequence number to hand out); after it come slotCount fixed
+    HISTORY_SLOT_SIZE slots, entry seq living in slot seq % slotCount.
+
+    Every shell maps the store at startup; nothing is parsed or copied, so
+    startup time and RSS do not depend on the history size. Appending holds
+    a shared flock (a rebuild holds an exclusive one), claims a sequence
+    number with a compare-and-swap on head, then claims the slot by swapping
+    its seq field to seq + 1 | HISTORY_SLOT_WRITING. A slot already owned by
+    a newer entry is left alone; one still being written by an older entry
+    is waited for, so two writers never fill a slot at once. The text is
+    written with pwrite and seq + 1 stored last to commit it. Readers copy
+    an entry out and re-check seq afterwards, so a slot being overwritten by
+    another shell reads as missing, never torn. Purge moves a shared
+    low-water mark up to head.
+
+    A command longer than HISTORY_TEXT_SIZE goes to the overflow area after
+    the slots, a ring of longSize bytes: its slot holds the record's
+    position in the ring's byte stream (claimed by CAS on longHead) and the
+    record repeats that position and the length. A record is never split
+    across the end of the ring, and is still valid while longHead has not
+    moved more than longSize past it. A command that does not fit in the
+    ring at all is kept cut short, ending in "...". Stores from before the
+    overflow area get one when they are next opened.
+
+    The slot count is fixed when the file is created (HISTSIZE, else
+    MAX_HISTORY); starting a shell with a different HISTSIZE rebuilds the
+    file at the new size, and shells still on the old file switch over on
+    their next append.
+
+    Resource usage recorded for an entry lives in <home>/.cshell_history.usage, one
+    history_usage record per slot, committed by storing seq + 1 last. A
+    record carries a hash of its entry's text, so one left behind by a
+    rebuilt store is never shown against a different command.
+*/
+
+struct history_header{
+    uint32_t magic;
+    uint32_t slotSize;
+    uint64_t slotCount;
+    uint64_t head;   // next sequence number; claimed by CAS
+    uint64_t purged; // entries below this were purged
+    uint64_t longSize; // bytes in the overflow area, 0 in stores that predate it
+    uint64_t longHead; // next position in the overflow area's byte stream; claimed by CAS
+};
+
+#define HISTORY_SLOT_WRITING (1ULL << 63) // in a slot's seq: claimed, text not yet written
+
+struct history_slot{
+    uint64_t seq;    // seq + 1 once committed, seq + 1 | HISTORY_SLOT_WRITING while being written
+    uint32_t length; // above HISTORY_TEXT_SIZE: text holds the position of a history_long record
+    uint32_t reserved;
+    char text[HISTORY_TEXT_SIZE];
+};
+
+// Header of a record in the overflow area; the text follows it
+struct history_long{
+    uint64_t start;  // its position in the byte stream, as the slot has it
+    uint64_t length;
+};
+
+struct history_usage{
+    uint64_t seq;      // seq + 1 of the entry, 0 while being written
+    uint32_t textHash; // FNV-1a of the entry's text
+    uint32_t stages;   // stages measured
+    uint64_t wallMicros;
+    uint64_t userMicros;
+    uint64_t sysMicros;
+    uint64_t maxRssKb; // largest single stage
+    uint64_t voluntarySwitches;
+    uint64_t involuntarySwitches;
+    uint64_t minorFaults;
+    uint64_t majorFaults;
+};
+
+enum history_sync{
+    HISTORY_SYNC_NEVER,    // leave it to the kernel
+    HISTORY_SYNC_PERIODIC, // fdatasync at most every HISTORY_FSYNC_SECONDS
+    HISTORY_SYNC_ALWAYS    // fdatasync after every append
+};
+
+extern int historySyncPolicy;
+
+extern int historyCapacity; // slot count of the open store
+
+// Map dir/HISTORY_FILE_NAME, creating it with capacity slots if needed (or rebuilding
+// it at that size if resize is set). Falls back to a private store if dir is unusable.
+bool historyOpen(const char* dir, int capacity, bool resize);
+
+// Pick up a store rebuilt by another shell
+void historyRefresh(void);
+
+// Record the first len bytes of commandString as the newest entry
+void historyPush(const char* commandString, size_t len);
+
+// Sequence number of this shell's last historyPush, HISTORY_NO_SEQ if it was not recorded
+uint64_t historyLastPushed(void);
+
+// Attach usage to entry seq, or read back what was attached (false if nothing was)
+void historySetUsage(uint64_t seq, const struct history_usage* usage);
+bool historyUsageBySeq(uint64_t seq, struct history_usage* out);
+
+// Live range: [historyOldestSeq(), historyNextSeq())
+uint64_t historyOldestSeq(void);
+uint64_t historyNextSeq(void);
+
+int historyCount(void);
+
+// index 1 is the newest entry. The returned copy is only valid until the next lookup;
+// NULL if out of range, purged, or being written by another shell.
+const char* historyEntry(int index);
+const char* historyEntryBySeq(uint64_t seq);
+
+// Purge every current entry, for all shells sharing the store
+void historyClear(void);
+
+// fdatasync per historySyncPolicy if anything was appended since the last one
+void historySync(bool force);
+
+void historyClose(void);
+
+#endif // HISTORY_H
\ No newline at end of file
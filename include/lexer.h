@@ -0,0 +1,24 @@
+#ifndef LEXER_H
+#define LEXER_H
+
+#include "parser.h"
+
+// Character classes used by the table-driven lexer
+#define CC_SPACE 0x01 // [[:space:]] in the C locale
+#define CC_GROUP 0x02 // ; and & (or &&&) end a cmd_group
+#define CC_PIPE  0x04 // | ends an atomic
+#define CC_REDIR 0x08 // < and > end a terminal
+
+extern const unsigned char lexCharClass[256];
+
+
+/*
+    Scan the input exactly once and build the whole shell_cmd -> cmd_group -> atomic
+    -> terminal tree in that same pass. Validity is decided during the scan and gives
+    the same result as running the tokenize* chain followed by checkShellCmd.
+    Every node, array and string comes from the given arena.
+*/
+
+struct shell_cmd* lexShellCommand(char* input, struct arena* arena);
+
+#endif // LEXER_H
\ No newline at end of file
@@ -0,0 +1,44 @@
+#ifndef OUTBUF_H
+#define OUTBUF_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include <unistd.h>
+
+#define OUTBUF_SIZE (256 * 1024)
+
+/*
+    A large write buffer over a raw fd, for builtins that print a lot
+    (reveal on huge directories). Output goes out in OUTBUF_SIZE write()s
+    instead of one stdio call per line; stdout is flushed first so earlier
+    printf output stays in order.
+
+    With outInitMemory the buffer has no fd and simply grows; the caller
+    reads buf/len and writes it out later (per-thread output of reveal -R).
+*/
+
+struct out_buffer{
+    int fd;     // -1: in-memory, never flushed
+    char* buf;
+    size_t len;
+    size_t size;
+    bool failed; // a write failed; the rest is dropped
+};
+
+bool outInit(struct out_buffer* out, int fd);
+
+bool outInitMemory(struct out_buffer* out);
+
+void outWrite(struct out_buffer* out, const char* data, size_t len);
+
+void outString(struct out_buffer* out, const char* s);
+
+void outFlush(struct out_buffer* out);
+
+// Flush and release
+void outFree(struct out_buffer* out);
+
+#endif // OUTBUF_H
\ No newline at end of file
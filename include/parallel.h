@@ -0,0 +1,49 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include <unistd.h>
+#include <sys/types.h>
+
+#include "plan.h"
+#include "outbuf.h"
+
+#define PARALLEL_MAX_JOBS 256      // upper bound for PARALLEL_JOBS
+#define PARALLEL_READ_SIZE 65536   // bytes read from a job's pipe at a time
+#define PARALLEL_FAILED_MAX 100    // the batch's exit status is its failed job count, capped here
+
+/*
+    "a &&& b &&& c": cmd_groups joined by &&& form one batch whose groups run
+    at the same time, at most PARALLEL_JOBS (default: online cores) at once.
+
+    The shell forks one batch leader, which leads a process group of its own
+    like a pipeline does: the terminal, Ctrl-C, Ctrl-Z, fg and bg all treat
+    the batch as one job. The leader starts each group in a child of its
+    group (stdin from /dev/null, stdout and stderr into pipes), starts the
+    next one whenever one finishes, and keeps each job's output in memory
+    until every job before it is done, so output comes out in submission
+    order. The oldest unfinished job's output is passed straight through.
+
+    The leader exits with the number of failed jobs (capped at
+    PARALLEL_FAILED_MAX), which becomes lastExitStatus; a trailing & puts
+    the whole batch in the background.
+*/
+
+struct parallel_job{
+    const struct plan_node* group;
+    pid_t pid;
+    int fds[2];             // read ends for stdout, stderr; -1 once at EOF
+    struct out_buffer out[2]; // held until the job reaches the head of the queue
+    int status;
+    bool started;
+    bool waited;
+};
+
+// Run the count group nodes of a batch; background if the last one ended with '&'
+void executeParallel(const struct plan_node** groups, int count, bool background);
+
+#endif // PARALLEL_H
\ No newline at end of file
@@ -0,0 +1,52 @@
+#ifndef PARSECACHE_H
+#define PARSECACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "parser.h"
+#include "plan.h"
+
+#define PARSE_CACHE_CAPACITY 64  // compiled plans kept, least recently used is evicted
+#define PARSE_CACHE_BUCKETS 128  // hash buckets, power of two
+
+struct parse_cache_entry{
+    uint64_t hash;
+    char* line;               // key, exact input line
+    int lineLength;
+    struct plan* plan;        // flat blob, immutable once cached
+    bool prepared;            // compiled ahead by prepareCommand and not looked up since
+    struct parse_cache_entry* lruPrev; // towards most recently used
+    struct parse_cache_entry* lruNext; // towards least recently used
+    struct parse_cache_entry* bucketNext;
+};
+
+struct parse_cache_stats{
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long evictions;
+    int entries;
+};
+
+extern struct parse_cache_stats parseCacheStats;
+
+uint64_t hashLine(const char* line, size_t length);
+
+// Returns the cached plan for this exact line, or NULL
+struct plan* parseCacheLookup(const char* line);
+
+// The cache takes ownership of the plan; returns false (plan untouched) if it could not
+bool parseCacheInsert(const char* line, struct plan* plan);
+
+// Cache lookup first; on a miss verifyCommand + compilePlan and insert.
+// Returns NULL for invalid lines (the syntax error has been printed).
+struct plan* cachedCompileCommand(char* inputCommand);
+
+// Compile a line that will run later into the cache without printing anything
+void prepareCommand(char* inputCommand);
+
+// cache builtin: print hit/miss counters and the parse arena's allocation counters;
+// "cache clear" drops the cached reveal listings
+void executeCache(int argc, char** argv);
+
+#endif // PARSECACHE_H
\ No newline at end of file
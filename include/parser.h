@@ -10,6 +10,8 @@
 #include <unistd.h>
 #include <regex.h>
 
+#include "arena.h"
+
 
 struct shell_cmd{
     // Struct representing full user input shell command
@@ -18,11 +20,23 @@ struct shell_cmd{
     char** separatorArr; // & or ; (separating char between cmd_group tokens)
     int cmdArrIndex;
     int sepArrIndex;
+    struct arena* arena; // arena backing the whole tree, NULL if built with malloc
+
+    // Set by the lexer: the owned copies of the input line that all strings point into
+    char* source;    // cmdString/atomicString/terminalString views
+    char* argBuffer; // cmdAndArgs slices, '\0'-terminated in place
+    int lineLength;
 };
 
 
+/*
+    cmdString, atomicString and terminalString are (pointer, length) views. Only
+    cmdString is guaranteed to be '\0'-terminated; use the length for the others.
+*/
+
 struct cmd_group{
     char* cmdString;
+    int cmdLength;
     bool validity;
     struct atomic** atomicArr;
     char** separatorArr; // | only
@@ -33,6 +47,7 @@ struct cmd_group{
 
 struct atomic{
     char* atomicString;
+    int atomicLength;
     bool validity;
     struct terminal** terminalArr; // array of name types
     char** separatorArr; // <, >, >>
@@ -42,6 +57,7 @@ struct atomic{
 
 struct terminal{
     char* terminalString; // string of the terminal to tokenize further
+    int terminalLength;
     char** cmdAndArgs; // array of strings
     int cmdAndArgsIndex;
     bool validity;
@@ -92,6 +108,9 @@ bool checkTerminals(struct terminal* terminalStruct);
 
 
 
+// Arena backing every tree built by verifyCommand; reset once the command has run
+extern struct arena parseArena;
+
 struct shell_cmd* verifyCommand(char* inputCommand);
 
 
@@ -13,39 +13,35 @@
  #include <sys/stat.h>
 
 #include "printPrompt.h"
+#include "cwd.h"
 #include "parser.h"
 #include "executes.h"
+#include "history.h"
+#include "histindex.h"
+#include "reveal.h"
+#include "revealcache.h"
 
 extern char* absoluteHomePath; // Global variable to hold the absolute home path
 
 extern char* oldWD;
 
-#define MAX_HISTORY 15
+#define MAX_HISTORY 15 // default history capacity; HISTSIZE overrides it
 
-struct executedShellCommand{
-    char* shellCommandString;
-    struct executedShellCommand* next;
-};
+void executeHop(int argCount, char** args);
 
-void executeHop(struct atomic* atomicCmd);
+void executeReveal(int argCount, char** args);
 
-void executeReveal(struct atomic* atomicCmd);
+bool checkRevealSyntax(int argCount, char** args);
 
-bool checkRevealSyntax(struct atomic* atomicGroup);
-
-void executeLog(struct atomic* atomicCmd);
-
-
-extern char* logFile;
-extern int logListSize;
-extern struct executedShellCommand* listHead;
-extern struct executedShellCommand* listTail;
+void executeLog(int argCount, char** args);
 
 
 void loadLogs();
 
 void saveLog();
 
+void closeLogs();
+
 void addLog(char* commandString);
 
 #endif // PARTB_H
@@ -4,17 +4,40 @@
 #include "parser.h"
 #include "executes.h"
 
-
+#define JOB_TABLE_MIN_BUCKETS 64 // power of two, doubled as the table fills
+
+/*
+    The one job table: background jobs and stopped foreground jobs, as seen by
+    fg, bg, activities, ping and the reaper. Each job is hashed by pid and by
+    job number, and all live jobs sit on a list in creation order whose tail is
+    the most recent job.
+*/
 struct job {
-    pid_t pid;
+    int job_num;     // monotonically increasing ID
+    pid_t pid;       // job leader, also the job's process group
     char *command;   // store a copy of command string
     int running;     // 1 = running, 0 = stopped
-    struct job* next;
+    int status;      // 0 live, 1 exited normally, 2 exited abnormally (set once removed)
+    struct job* next;    // creation order; reused by the completion queue once removed
+    struct job* prev;
+    struct job* pidNext; // hash chains
+    struct job* numNext;
 };
 
-extern struct job* job_list;
+extern struct job* job_list; // oldest live job
+extern int jobCount;
+
+// Add a job; returns the assigned job number or -1 on failure.
+int addJob(pid_t pid, char* commandString, int running);
+
+struct job* findJobByPid(pid_t pid);
+struct job* findJobByNum(int job_num);
+struct job* mostRecentJob(void);
+
+// Take a job out of the table without freeing it
+struct job* detachJob(pid_t pid);
 
-void addJob(pid_t pid, char* commandString, int running);
+void freeJob(struct job* job);
 
 void removeJob(pid_t pid);
 
@@ -0,0 +1,52 @@
+#ifndef PATHCACHE_H
+#define PATHCACHE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define PATH_CACHE_BUCKETS 64 // power of two
+
+/*
+    Command name -> absolute path, like bash's hash table. An entry remembers
+    which PATH directory it was found in; it is dropped when PATH changes or
+    when the mtime of that directory, or of any directory searched before it,
+    changes (a new file there could now shadow it). Directories are re-stat'ed
+    at most once per command line, and only if that line resolves something.
+    Hits in relative PATH entries ("" or ".") depend on the cwd and are never cached,
+    and a cwd change drops every entry found after the first relative entry, since
+    the new directory may shadow it.
+*/
+
+struct path_cache_entry{
+    char* name;
+    char* path;
+    int dirIndex;  // index into the parsed PATH
+    unsigned long hits;
+    struct path_cache_entry* next;
+};
+
+struct path_dir{
+    char* dir;
+    struct timespec mtime;
+    bool relative;
+};
+
+// Ask for a PATH/mtime check before the next lookup (called once per command line)
+void pathCacheRevalidate(void);
+
+// Absolute path to exec for a command name, or NULL if it is not found on PATH.
+// Names containing '/' are returned unchanged. The string belongs to the cache
+// (or to the caller) and is only valid until the next call; use it right away.
+const char* resolveCommand(const char* name);
+
+void pathCacheClear(void);
+
+// hash builtin: "hash" lists entries, "hash -r" forgets them all, "hash name..." adds names
+void executeHash(int argc, char** argv);
+
+#endif // PATHCACHE_H
\ No newline at end of file
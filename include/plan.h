@@ -0,0 +1,72 @@
+#ifndef PLAN_H
+#define PLAN_H
+
+#include "parser.h"
+
+/*
+    A validated shell_cmd lowered into one contiguous, immutable blob:
+
+        struct plan | plan_node[nodeCount] | redir[] | argv pointers | line copies
+
+    Every cmd_group becomes a group node followed by one stage node per atomic
+    in its pipeline, so a whole command is walked front to back with no pointer
+    chasing and no separator strcmp. The blob is a single malloc and is what
+    the parse cache keeps.
+*/
+
+enum plan_op{
+    OP_GROUP,     // cmd_group run in the foreground (';' or end)
+    OP_GROUP_BG,  // cmd_group followed by '&'
+    OP_GROUP_PAR, // cmd_group followed by "&&&": runs in parallel with the next one
+    OP_STAGE,     // one atomic of the preceding group's pipeline
+};
+
+enum builtin_id{
+    BUILTIN_NONE = 0, // external command
+    BUILTIN_HOP,
+    BUILTIN_REVEAL,
+    BUILTIN_LOG,
+    BUILTIN_ACTIVITIES,
+    BUILTIN_PING,
+    BUILTIN_FG,
+    BUILTIN_BG,
+    BUILTIN_EXIT,
+    BUILTIN_CACHE,
+    BUILTIN_LAUNCH,
+    BUILTIN_HASH,
+    BUILTIN_EACH,
+    BUILTIN_TIME,
+    BUILTIN_TIMING,
+    BUILTIN_STATS,
+};
+
+enum redir_mode{
+    REDIR_READ = 0,   // <
+    REDIR_WRITE = 1,  // >
+    REDIR_APPEND = 2, // >>
+};
+
+struct plan_node{
+    unsigned char op;      // enum plan_op
+    unsigned char builtin; // enum builtin_id, stages only
+    int stageCount;        // group nodes: pipeline length (stage nodes that follow)
+    int argc;              // stages: argv of the first terminal
+    char** argv;           // NULL-terminated
+    int redirCount;        // stages: redirections in the order they are applied
+    struct redir* redirs;
+    char* text;            // group: cmdString ('\0'-terminated); stage: atomicString view
+    int textLength;
+};
+
+struct plan{
+    size_t size; // bytes in the whole blob
+    int nodeCount;
+    struct plan_node nodes[];
+};
+
+// Lower a valid lexer-built tree into a freshly malloc'd plan (free with free())
+struct plan* compilePlan(const struct shell_cmd* shellCommand);
+
+enum builtin_id lookupBuiltin(const char* name);
+
+#endif // PLAN_H
\ No newline at end of file
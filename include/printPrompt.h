@@ -14,4 +14,7 @@ bool isSubstring(char* absPath, char* currPath);
 
 char* getPathToPrint(char* absPath, char* currPath);
 
+// "<user@host:path> " for the current directory; cached until the directory changes
+const char* getPrompt(const char* username, const char* hostname, char* absPath);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,49 @@
+#ifndef REAPER_H
+#define REAPER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include <unistd.h>
+#include <sys/types.h>
+
+#include "usage.h"
+
+/*
+    The one place child statuses are collected. SIGCHLD is blocked in the shell
+    and read through a signalfd, which sits in an epoll set next to stdin: the
+    shell sleeps in epoll_wait both at the prompt and while a foreground job runs,
+    and every wait4(-1) result is dispatched from reapChildren. Foreground
+    pids waited on by reaperWaitPids get their status recorded; everything else
+    goes to jobStatusChanged (executes.c), which keeps the job lists current and
+    queues completion messages.
+
+    Forked children that keep running shell code call reaperChildInit: SIGCHLD is
+    unblocked for anything they exec, and their own waits fall back to plain
+    blocking waitpid(-1).
+*/
+
+// Block SIGCHLD and set up the signalfd + epoll set; the shell falls back to blocking waitpid if this fails
+void reaperInit(void);
+
+// In a freshly forked child
+void reaperChildInit(void);
+
+// Collect every pending status without blocking
+void reapChildren(void);
+
+// Block until each of the count pids (<= 0 entries are skipped) has exited or stopped.
+// statuses[i] receives the wait status of pids[i].
+void reaperWaitPids(const pid_t* pids, int count, int* statuses);
+
+// Same, and usages[i] gets the wall time and rusage of pids[i] once it exits (see usage.h)
+void reaperWaitPidsUsage(const pid_t* pids, int count, int* statuses, struct stage_usage* usages);
+
+// Block until fd is readable (true), or until a child changes state and a
+// completion message is waiting to be printed by check_bg_jobs (false).
+// A due stats export (see stats.h) is written while it waits.
+bool waitForInput(int fd);
+
+#endif // REAPER_H
\ No newline at end of file
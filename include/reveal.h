@@ -0,0 +1,101 @@
+#ifndef REVEAL_H
+#define REVEAL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <sys/types.h>
+
+#include "arena.h"
+#include "outbuf.h"
+
+#define REVEAL_DENTS_FIRST_BATCH 16384   // first getdents64 buffer; later ones double
+#define REVEAL_DENTS_BATCH (1024 * 1024) // largest getdents64 buffer
+#define REVEAL_DENTS_MIN_TAIL 4096       // a buffer tail smaller than this is not read into
+#define REVEAL_INSERTION_CUTOFF 16       // partitions this small are insertion sorted
+#ifndef REVEAL_STAT_THREADS // bench-statx builds a sequential shell with -DREVEAL_STAT_THREADS=1
+#define REVEAL_STAT_THREADS 8            // statx workers; they overlap lookup latency, so more than cores
+#endif
+#define REVEAL_STAT_CHUNK 64             // entries a worker claims at a time
+#define REVEAL_STAT_PARALLEL_MIN 256     // smaller listings are stat'ed by the shell thread alone
+#define REVEAL_WALK_MAX_THREADS 64       // reveal -R: one walker per online core, up to this
+
+/*
+    The listing engine behind reveal. Directory entries are read with
+    getdents64 straight into the listing's arena, and each entry just
+    points at the name inside its record: no per-entry allocation or copy.
+    Each read goes into the unused tail of the current buffer; only when
+    that runs short is a new buffer taken, twice the size of the last, up
+    to REVEAL_DENTS_BATCH. Small directories (and every directory of a
+    reveal -R walk) so cost one small chunk, not megabytes. Names are sorted by multikey quicksort,
+    which yields the same order as qsort with strcmp, and printed through
+    one large out_buffer.
+
+    reveal -R walks the tree on one thread per core. Each walker owns a
+    deque of directories still to read: it pushes the subdirectories it
+    finds and pops its newest one (depth first, warm caches), and an idle
+    walker steals the oldest one from another deque, which is the nearest
+    to the root and so likely the largest remaining subtree. A directory's
+    header and listing go into its walker's in-memory out_buffer; once the
+    walk is over they are written out depth first in sorted order, so the
+    output is the same whatever thread read what.
+*/
+
+struct reveal_entry{
+    const char* name;   // NUL-terminated, inside the arena
+    uint64_t key;       // sort scratch: 8 name bytes at the current depth
+    unsigned char type; // d_type (DT_UNKNOWN on filesystems that do not report it)
+};
+
+struct reveal_stat{
+    bool valid; // false if the entry vanished or could not be stat'ed
+    mode_t mode;
+    nlink_t nlink;
+    uid_t uid;
+    gid_t gid;
+    off_t size;
+    uint64_t blocks; // 512-byte units
+    unsigned int rdevMajor; // device files
+    unsigned int rdevMinor;
+    time_t mtime;
+    char* linkTarget; // symlinks only
+};
+
+struct reveal_listing{
+    struct arena arena; // getdents64 batches
+    struct reveal_entry* entries;
+    size_t count;
+    size_t capacity;
+};
+
+// Read every entry of dirPath, hidden ones only with all. False (and nothing
+// to free) if the directory cannot be read.
+bool revealCollect(struct reveal_listing* listing, const char* dirPath, bool all);
+
+// strcmp order
+void revealSort(struct reveal_entry* entries, size_t count);
+
+// One name per line, or two-space separated on one line
+void revealFormat(struct out_buffer* out, const struct reveal_listing* listing, bool lines);
+void revealPrint(const struct reveal_listing* listing, bool lines);
+
+// Long listing of entries (names relative to dirFd), with a "total" line if total is
+// set; the statx calls are spread over REVEAL_STAT_THREADS only if parallel is set
+void revealFormatLong(struct out_buffer* out, int dirFd, const struct reveal_entry* entries, size_t count,
+                      bool total, bool parallel);
+
+// Long listing of every entry of a listing collected from dirPath
+void revealPrintLong(const struct reveal_listing* listing, const char* dirPath);
+
+// Long listing line for one non-directory path
+void revealPrintLongFile(const char* path);
+
+void revealFree(struct reveal_listing* listing);
+
+// reveal -R: dirPath and every directory below it (symlinks are not followed)
+void revealWalk(const char* dirPath, bool all, bool longFormat);
+
+#endif // REVEAL_H
\ No newline at end of file
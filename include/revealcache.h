@@ -0,0 +1,66 @@
+#ifndef REVEALCACHE_H
+#define REVEALCACHE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include <sys/stat.h>
+
+#include "reveal.h"
+
+#define REVEAL_CACHE_CAPACITY 32                 // listings kept, least recently used is evicted
+#define REVEAL_CACHE_MAX_BYTES (64 * 1024 * 1024) // memory budget; one listing may use half of it
+#define REVEAL_CACHE_RACY_SECONDS 2              // directories modified this recently are not cached
+
+/*
+    Sorted reveal listings of recently shown directories, keyed by (device,
+    inode) and whether hidden entries were included. An entry is valid as
+    long as the directory's mtime and ctime are what they were when it was
+    read: creating, removing or renaming an entry changes the mtime, and
+    anything that swaps the directory out changes the inode. A hit costs one
+    stat of the directory instead of open, getdents64 and the sort.
+
+    Timestamps only move in clock ticks, so a change made in the same tick
+    as the read could go unseen; directories modified in the last
+    REVEAL_CACHE_RACY_SECONDS are therefore never cached. Long listings
+    still stat every entry, since file metadata does not touch the
+    directory's timestamps.
+*/
+
+struct reveal_cache_entry{
+    dev_t dev;
+    ino_t ino;
+    bool all;
+    struct timespec mtime;
+    struct timespec ctime;
+    struct reveal_entry* entries; // one block: entries, then the names they point to
+    size_t count;
+    size_t bytes;
+    struct reveal_cache_entry* lruPrev; // towards most recently used
+    struct reveal_cache_entry* lruNext; // towards least recently used
+};
+
+struct reveal_cache_stats{
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long invalidations; // found, but the directory had changed
+    unsigned long evictions;
+    int entries;
+    size_t bytes;
+};
+
+extern struct reveal_cache_stats revealCacheStats;
+
+// Sorted entries of the directory st describes, or NULL. The entries belong to the
+// cache and stay valid until the next insert or clear.
+const struct reveal_entry* revealCacheLookup(const struct stat* st, bool all, size_t* count);
+
+// Keep a copy of a sorted listing read from the directory st describes (stat'ed
+// before it was read)
+void revealCacheInsert(const struct stat* st, bool all, const struct reveal_listing* listing);
+
+void revealCacheClear(void);
+
+#endif // REVEALCACHE_H
\ No newline at end of file
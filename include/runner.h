@@ -0,0 +1,45 @@
+#ifndef RUNNER_H
+#define RUNNER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include <unistd.h>
+
+#define READER_CHUNK_SIZE 65536 // bytes asked of read() at a time
+
+/*
+    Line reader for batch mode: one growing buffer filled with large read()s.
+    Lines are handed out in place ('\n' replaced by '\0'), so there is no cap on
+    their length other than memory. A returned line stays valid until the next
+    readerNextLine call.
+*/
+struct line_reader{
+    int fd;
+    char* buf;
+    size_t size;    // allocated bytes
+    size_t start;   // first unconsumed byte
+    size_t end;     // bytes filled
+    size_t peekEnd; // terminator of the peeked line, valid while peeked
+    bool peeked;
+    bool eof;
+};
+
+bool readerInit(struct line_reader* reader, int fd);
+void readerFree(struct line_reader* reader);
+
+// Next line, or NULL once the input is exhausted (a last line without '\n' is still returned)
+char* readerNextLine(struct line_reader* reader);
+
+// The line readerNextLine will return next if it is already buffered, else NULL; never reads
+char* readerPeekLine(struct line_reader* reader);
+
+// Verify, log and execute one input line (shared by the interactive and batch loops)
+void runInputLine(char* input);
+
+// Run every line from fd without any prompt work; returns at end of input
+void runBatch(int fd);
+
+#endif // RUNNER_H
\ No newline at end of file
@@ -0,0 +1,52 @@
+#ifndef SPAWN_H
+#define SPAWN_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <unistd.h>
+#include <sys/types.h>
+
+#include "plan.h"
+#include "pathcache.h"
+
+/*
+    How external commands are started. LAUNCH_SPAWN uses posix_spawn of the
+    path resolved by pathcache, which glibc implements with clone(CLONE_VM|
+    CLONE_VFORK): the shell's page tables are never copied, so launch cost
+    does not grow with the shell's heap.
+    LAUNCH_FORK is the original fork + execvp path. LAUNCH_ZYGOTE hands the
+    spawn to the zygote helper (see zygote.h). Builtins in pipelines and
+    background job leaders always fork since they run shell code in the child.
+*/
+enum launch_backend{
+    LAUNCH_FORK,
+    LAUNCH_SPAWN,
+    LAUNCH_ZYGOTE,
+};
+
+extern int launchBackend;
+
+// open() flags for a redirection's mode
+int redirFlags(const struct redir* r);
+
+// open() a redirection target with the flags its mode calls for (close-on-exec)
+int openRedirTarget(const struct redir* r);
+
+/*
+    Start an external stage with everything the forked children do:
+    join process group pgid (0 = new group led by the child), SIG_DFL for the
+    job control signals, stdin/stdout from inFd/outFd (-1 = inherit), closeFds
+    closed, then the stage's redirections opened by the child itself. The shell
+    touches no fds at all on this path.
+    Returns the child's pid or -1 (the error has been printed).
+*/
+pid_t spawnStage(const struct plan_node* stage, int inFd, int outFd, pid_t pgid,
+                 const int* closeFds, int closeCount);
+
+// launch builtin: "launch" shows the backend, "launch fork|spawn|zygote" selects it,
+// "launch bench [N]" times N starts of true with each backend
+void executeLaunch(int argc, char** argv);
+
+#endif // SPAWN_H
\ No newline at end of file
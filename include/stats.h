@@ -0,0 +1,73 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include <stdint.h>
+#include <time.h>
+
+#define STATS_BUCKETS 40          // bucket i counts samples of [2^i, 2^(i+1)) ns; the last one takes the rest
+#define STATS_EXPORT_SECONDS 10   // default "stats export" interval
+
+/*
+    The shell's own overhead, measured from inside. Each probe is a pair of
+    CLOCK_MONOTONIC reads (vDSO, no syscall) around the code it covers and an
+    increment of a power-of-two latency bucket, so probes stay on in every
+    build. Percentiles are read off the buckets, so they are only good to a
+    factor of two; count, mean and max are exact.
+
+    "stats" prints every histogram and counter, "stats reset" zeroes them.
+    "stats export <file> [seconds]" rewrites file (through a rename, so
+    readers never see half of it) with a JSON snapshot whenever the interval
+    has passed: checked when a command line finishes, and on a timer while
+    the shell waits at the prompt. "stats export off" stops it.
+*/
+
+enum stats_histogram{
+    STATS_PARSE,    // verifyCommand on a parse cache miss
+    STATS_LAUNCH,   // start of a child up to its exec (posix_spawn returns after it); fork backend: fork()
+    STATS_JOBS,     // check_bg_jobs and updateJobs
+    STATS_HISTORY,  // history writes and syncs (addLog, saveLog)
+    STATS_DISPATCH, // a line in hand up to its command starting
+    STATS_PROMPT,   // a command line done up to the next prompt on screen
+    STATS_HISTOGRAMS
+};
+
+enum stats_counter{
+    STATS_LINES,         // command lines run
+    STATS_JOBS_FINISHED, // background jobs seen ending
+    STATS_COUNTERS
+};
+
+struct stats_histogram_data{
+    uint64_t count;
+    uint64_t totalNanos;
+    uint64_t maxNanos;
+    uint64_t buckets[STATS_BUCKETS];
+    uint64_t pendingStart; // statsBegin time, 0 if none
+};
+
+uint64_t statsNow(void);
+
+// One sample: from start (a statsNow value) to now
+void statsRecord(enum stats_histogram id, uint64_t start);
+
+// For spans that start and end in different places: statsEnd records only after a statsBegin
+void statsBegin(enum stats_histogram id);
+void statsEnd(enum stats_histogram id);
+
+void statsCount(enum stats_counter id);
+
+// Write the export file if one is set up and its interval has passed
+void statsTick(void);
+
+// Milliseconds until statsTick is next due, for a shell idle at the prompt; -1 without an export
+int statsTickTimeout(void);
+
+// stats builtin: "stats", "stats reset", "stats export <file> [seconds]|off"
+void executeStats(int argc, char** argv);
+
+#endif // STATS_H
\ No newline at end of file
@@ -0,0 +1,69 @@
+#ifndef USAGE_H
+#define USAGE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "plan.h"
+
+/*
+    Resource accounting. Foreground children are reaped with wait4, so every
+    stage of a foreground group gets its wall time (start to reap) and the
+    rusage the kernel kept for it: user and system CPU, max RSS, voluntary and
+    involuntary context switches, minor and major faults. A builtin run by the
+    shell itself is charged what the shell and the children it reaped used
+    meanwhile.
+
+    "time cmd | cmd2" prints each stage and the group total to stderr.
+    "timing on" measures every foreground group without printing. Either way
+    the line's total is stored next to its history entry (history.h), and
+    "log time" lists what each past command cost.
+
+    Background jobs are not measured; "time" in one is accepted and ignored.
+    The kernel carries an exec'ing process's RSS high-water mark over from the
+    address space it was started from, so a child's max RSS never reads below
+    the shell's own.
+*/
+
+struct stage_usage{
+    struct timespec start; // set when the stage is started
+    struct timespec end;   // set when it is reaped
+    struct rusage ru;
+    bool measured;         // false until reaped
+    bool stopped;          // stopped instead: nothing to report yet
+};
+
+extern bool timingAlways; // "timing on"
+
+void usageStart(struct stage_usage* usage);
+
+// A child was reaped with ru
+void usageFinish(struct stage_usage* usage, const struct rusage* ru);
+
+// Builtins run by the shell itself: snapshot getrusage before, charge the difference after
+void usageShellBegin(struct stage_usage* usage);
+void usageShellEnd(struct stage_usage* usage);
+
+// Print a group's stages and, for a pipeline, their total to stderr
+void usageReport(const struct plan_node* stages, const struct stage_usage* usages, int count);
+
+// Per input line: totals of every foreground group measured while it ran,
+// stored with history entry seq unless seq is HISTORY_NO_SEQ (nothing logged)
+void usageLineBegin(void);
+void usageLineAdd(const struct stage_usage* usages, int count);
+void usageLineEnd(uint64_t seq);
+
+// "log time": every history entry with its recorded cost, oldest first
+void printLogUsage(void);
+
+// timing builtin: "timing" shows the mode, "timing on|off" sets it
+void executeTiming(int argc, char** argv);
+
+#endif // USAGE_H
\ No newline at end of file
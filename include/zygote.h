@@ -0,0 +1,70 @@
+#ifndef ZYGOTE_H
+#define ZYGOTE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+#include "plan.h"
+
+#define ZYGOTE_MAX_REQUEST 65536 // larger requests (huge argv) are spawned directly
+
+/*
+    The zygote: an optional helper forked at startup (SHELL_ZYGOTE set and
+    not "0"), before the history store is mapped and while the shell's image
+    is still small. With the zygote launch backend, spawnStage sends it each
+    external stage over a SOCK_SEQPACKET socket pair:
+
+        zygote_request | zygote_redir[redirCount] | path, argv..., filenames ('\0'-separated)
+
+    plus stdin, stdout, stderr and the shell's cwd as SCM_RIGHTS fds. The
+    zygote starts the child with clone(CLONE_PARENT), so the child is the
+    shell's own child: wait4, rusage, job control and the reaper see nothing
+    different. The child joins pgid (0 = a group of its own), takes the
+    terminal if it leads a foreground job (so that it cannot read the tty
+    before the shell has handed it over, which the extra round trip would
+    otherwise make likely), resets the job control signals, fchdirs, takes
+    the three fds, opens its redirections and execs; an errno from any step comes back through a close-on-exec
+    pipe. The reply (pid, errno) is sent once the child has exec'd or failed,
+    as posix_spawn returns.
+
+    Only the shell process itself talks to the zygote; forked children that
+    run shell code (background leaders, each) spawn directly. If the zygote
+    dies the shell goes back to the spawn backend.
+*/
+
+struct zygote_request{
+    int32_t pgid;
+    int32_t argc;
+    int32_t redirCount;
+    int32_t foreground; // the child takes the terminal before it execs
+    uint32_t length; // bytes of strings after the redirection table
+};
+
+struct zygote_redir{
+    int32_t targetFd;
+    int32_t flags;   // open() flags
+};
+
+struct zygote_reply{
+    int32_t pid;
+    int32_t err;     // errno of the failed step, 0 if the child exec'd
+};
+
+// Fork the helper; false if it could not be started
+bool zygoteStart(void);
+
+bool zygoteRunning(void);
+
+// Start stage (resolved to path) through the zygote, as spawnStage would with these
+// arguments. False if the zygote cannot take it (not running, not the shell process,
+// request too large): spawn it directly instead. Otherwise *pid, or *err if it failed.
+bool zygoteSpawn(const struct plan_node* stage, const char* path, int inFd, int outFd, pid_t pgid,
+                 pid_t* pid, int* err);
+
+#endif // ZYGOTE_H
\ No newline at end of file
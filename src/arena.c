@@ -0,0 +1,113 @@
+#include "../include/arena.h"
+#include <stdint.h>
+
+#define ARENA_ALIGN (sizeof(void*) > 8 ? sizeof(void*) : 8)
+
+
+void arenaInit(struct arena* arena, size_t chunkSize){
+    memset(arena, 0, sizeof(struct arena));
+    arena->chunkSize = chunkSize ? chunkSize : ARENA_CHUNK_SIZE;
+}
+
+// Try to carve size bytes out of a chunk; returns NULL if it does not fit
+static void* carve(struct arena_chunk* chunk, size_t size, size_t align){
+    uintptr_t base = (uintptr_t)chunk->data;
+    uintptr_t start = (base + chunk->used + align - 1) & ~(uintptr_t)(align - 1);
+    if (start + size > base + chunk->size) return NULL;
+    chunk->used = (size_t)(start - base) + size;
+    return (void*)start;
+}
+
+static void* arenaAllocAligned(struct arena* arena, size_t size, size_t align){
+    struct arena_chunk* chunk = arena->current;
+    void* ptr = NULL;
+
+    // Walk forward through chunks retained from earlier commands before asking malloc
+    while (chunk != NULL) {
+        ptr = carve(chunk, size, align);
+        if (ptr != NULL || chunk->next == NULL) break;
+        chunk = chunk->next;
+        chunk->used = 0;
+        arena->current = chunk;
+    }
+
+    if (ptr == NULL) {
+        size_t chunkBytes = (size + align > arena->chunkSize) ? size + align : arena->chunkSize;
+        struct arena_chunk* fresh = (struct arena_chunk*)malloc(sizeof(struct arena_chunk) + chunkBytes);
+        if (fresh == NULL) return NULL;
+        fresh->next = NULL;
+        fresh->size = chunkBytes;
+        fresh->used = 0;
+        if (chunk != NULL) chunk->next = fresh; else arena->head = fresh;
+        arena->current = fresh;
+        arena->mallocCount++;
+        ptr = carve(fresh, size, align);
+    }
+
+    arena->allocCount++;
+    arena->bytesInUse += size;
+    arena->lastAlloc = ptr;
+    return ptr;
+}
+
+void* arenaAlloc(struct arena* arena, size_t size){
+    return arenaAllocAligned(arena, size, ARENA_ALIGN);
+}
+
+void* arenaCalloc(struct arena* arena, size_t size){
+    void* ptr = arenaAllocAligned(arena, size, ARENA_ALIGN);
+    if (ptr != NULL) memset(ptr, 0, size);
+    return ptr;
+}
+
+void* arenaRealloc(struct arena* arena, void* ptr, size_t oldSize, size_t newSize){
+    if (ptr == NULL) return arenaAlloc(arena, newSize);
+    if (newSize <= oldSize) return ptr;
+
+    // The most recent allocation can simply be extended if its chunk has room
+    struct arena_chunk* chunk = arena->current;
+    if (ptr == arena->lastAlloc && chunk != NULL) {
+        size_t offset = (size_t)((char*)ptr - chunk->data);
+        if (offset + newSize <= chunk->size) {
+            chunk->used = offset + newSize;
+            arena->bytesInUse += newSize - oldSize;
+            return ptr;
+        }
+    }
+
+    void* grown = arenaAlloc(arena, newSize);
+    if (grown == NULL) return NULL;
+    memcpy(grown, ptr, oldSize);
+    return grown;
+}
+
+char* arenaStrndup(struct arena* arena, const char* src, size_t length){
+    char* copy = (char*)arenaAllocAligned(arena, length + 1, 1);
+    if (copy == NULL) return NULL;
+    memcpy(copy, src, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+void arenaReset(struct arena* arena){
+    // Chunks after head get their 'used' cleared lazily as allocation reaches them
+    if (arena->head != NULL) arena->head->used = 0;
+    arena->current = arena->head;
+    arena->lastAlloc = NULL;
+    if (arena->bytesInUse > arena->highWater) arena->highWater = arena->bytesInUse;
+    arena->bytesInUse = 0;
+    arena->resetCount++;
+}
+
+void arenaDestroy(struct arena* arena){
+    struct arena_chunk* chunk = arena->head;
+    while (chunk != NULL) {
+        struct arena_chunk* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    arena->head = NULL;
+    arena->current = NULL;
+    arena->lastAlloc = NULL;
+    arena->bytesInUse = 0;
+}
@@ -0,0 +1,78 @@
+#include "../include/cwd.h"
+
+char* currentWD = NULL;
+unsigned long cwdGeneration = 0;
+
+
+bool cwdInit(void){
+    currentWD = getcwd(NULL, 0);
+    cwdGeneration++;
+    return currentWD != NULL;
+}
+
+// Drop the last component of a canonical path held in path[0..length)
+static size_t parentLength(const char* path, size_t length){
+    while (length > 1 && path[length - 1] != '/') length--;
+    if (length > 1) length--; // the separator, unless it is the root
+    return length;
+}
+
+// currentWD joined with target, with "." and ".." resolved lexically. NULL if a named
+// component is not a plain directory (a symlink, most likely): only the kernel knows
+// where that leads.
+static char* resolveLexically(const char* target){
+    size_t capacity = strlen(currentWD) + strlen(target) + 2;
+    char* path = (char*)malloc(capacity);
+    if (path == NULL) return NULL;
+    size_t length = 0;
+    if (target[0] != '/') {
+        length = strlen(currentWD);
+        memcpy(path, currentWD, length);
+    } else {
+        path[length++] = '/';
+    }
+    path[length] = '\0';
+
+    const char* component = target;
+    while (*component != '\0') {
+        size_t componentLength = strcspn(component, "/");
+        if (componentLength == 2 && component[0] == '.' && component[1] == '.') {
+            length = parentLength(path, length);
+            path[length] = '\0';
+        } else if (componentLength > 0 && !(componentLength == 1 && component[0] == '.')) {
+            if (length > 1) path[length++] = '/';
+            memcpy(path + length, component, componentLength);
+            length += componentLength;
+            path[length] = '\0';
+            struct stat st;
+            if (lstat(path, &st) != 0 || !S_ISDIR(st.st_mode)) {
+                free(path);
+                return NULL;
+            }
+        }
+        component += componentLength;
+        while (*component == '/') component++;
+    }
+    return path;
+}
+
+char* cwdChange(const char* target, bool canonical){
+    if (chdir(target) != 0) return NULL;
+
+    char* path = canonical ? strdup(target) : resolveLexically(target);
+    if (path == NULL) path = getcwd(NULL, 0);
+    if (path == NULL) {
+        // Cannot tell where we are: go back to where we know we were
+        if (chdir(currentWD) != 0) perror("chdir");
+        return NULL;
+    }
+    char* previous = currentWD;
+    currentWD = path;
+    cwdGeneration++;
+    return previous;
+}
+
+char* cwdParent(void){
+    size_t length = parentLength(currentWD, strlen(currentWD));
+    return strndup(currentWD, length);
+}
\ No newline at end of file
@@ -0,0 +1,215 @@
+#include "../include/each.h"
+#include "../include/executes.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+struct each_map{
+    char** argv;          // template, then up to maxItems items, then NULL
+    int templateCount;
+    int maxItems;
+    int itemCount;
+    size_t* items;        // offsets of the pending items in buf (buf may move)
+    char* buf;
+    size_t len;
+    size_t capacity;
+    size_t lineStart;     // first byte not yet split into an item
+    pid_t* pids;          // running commands, 0 = free slot
+    int limit;
+    int running;
+    pid_t pgid;
+    int devNull;
+    int status;
+};
+
+
+static bool parseCount(const char* value, long max, int* out){
+    char* end = NULL;
+    long count = strtol(value, &end, 10);
+    if (end == value || *end != '\0' || count < 0) return false;
+    if (count == 0 || count > max) count = max;
+    *out = (int)count;
+    return true;
+}
+
+// Block until one command exits and free its slot
+static void waitOne(struct each_map* map){
+    while (map->running > 0) {
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) {
+            if (errno == EINTR) continue;
+            map->running = 0; // ECHILD: nothing left
+            return;
+        }
+        for (int i = 0; i < map->limit; i++) {
+            if (map->pids[i] != pid) continue;
+            map->pids[i] = 0;
+            map->running--;
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) map->status = 123;
+            return;
+        }
+    }
+}
+
+// Start cmd with the pending items, waiting for a free slot first
+static void launch(struct each_map* map){
+    if (map->itemCount == 0) return;
+    if (map->running == map->limit) waitOne(map);
+    for (int i = 0; i < map->itemCount; i++) map->argv[map->templateCount + i] = map->buf + map->items[i];
+    map->argv[map->templateCount + map->itemCount] = NULL;
+
+    struct plan_node stage;
+    memset(&stage, 0, sizeof(stage));
+    stage.op = OP_STAGE;
+    stage.argc = map->templateCount + map->itemCount;
+    stage.argv = map->argv;
+    pid_t pid = spawnStage(&stage, map->devNull, -1, map->pgid, NULL, 0);
+    map->itemCount = 0;
+    if (pid < 0) {
+        map->status = 123;
+        return;
+    }
+    for (int i = 0; i < map->limit; i++) {
+        if (map->pids[i] != 0) continue;
+        map->pids[i] = pid;
+        map->running++;
+        break;
+    }
+}
+
+static void addItem(struct each_map* map, size_t offset){
+    map->items[map->itemCount++] = offset;
+    if (map->itemCount == map->maxItems) launch(map);
+}
+
+// Room for at least EACH_READ_SIZE more bytes: drop what has been launched, grow if still short
+static bool makeRoom(struct each_map* map){
+    size_t keep = map->itemCount > 0 ? map->items[0] : map->lineStart;
+    if (keep > 0) {
+        memmove(map->buf, map->buf + keep, map->len - keep);
+        map->len -= keep;
+        map->lineStart -= keep;
+        for (int i = 0; i < map->itemCount; i++) map->items[i] -= keep;
+    }
+    if (map->capacity - map->len >= EACH_READ_SIZE) return true;
+    size_t newCapacity = map->capacity ? map->capacity * 2 : 2 * EACH_READ_SIZE;
+    while (newCapacity - map->len < EACH_READ_SIZE) newCapacity *= 2;
+    char* grown = (char*)realloc(map->buf, newCapacity);
+    if (grown == NULL) {
+        perror("realloc failed");
+        return false;
+    }
+    map->buf = grown;
+    map->capacity = newCapacity;
+    return true;
+}
+
+// Split stdin into lines, launching a command for every maxItems of them
+static void runMap(struct each_map* map){
+    while (1) {
+        if (map->capacity - map->len < EACH_READ_SIZE && !makeRoom(map)) break;
+        ssize_t got = read(STDIN_FILENO, map->buf + map->len, EACH_READ_SIZE);
+        if (got < 0 && errno == EINTR) continue;
+        if (got < 0) perror("each: read failed");
+        if (got <= 0) break;
+
+        size_t end = map->len + (size_t)got;
+        char* newline;
+        while ((newline = memchr(map->buf + map->len, '\n', end - map->len)) != NULL) {
+            size_t at = (size_t)(newline - map->buf);
+            *newline = '\0';
+            map->len = at + 1;
+            size_t start = map->lineStart;
+            map->lineStart = at + 1;
+            if (at > start) addItem(map, start);
+        }
+        map->len = end;
+    }
+    // A last line without '\n' (the read loop leaves space for its terminator)
+    if (map->lineStart < map->len && map->len < map->capacity) {
+        map->buf[map->len++] = '\0';
+        addItem(map, map->lineStart);
+        map->lineStart = map->len;
+    }
+    launch(map);
+    while (map->running > 0) waitOne(map);
+}
+
+
+pid_t executeEach(int argc, char** argv, bool ownJob){
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int limit = (cores < 1) ? 1 : (cores > EACH_MAX_JOBS) ? EACH_MAX_JOBS : (int)cores;
+    int maxItems = 1;
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-'; i += 2) {
+        bool ok = i + 1 < argc;
+        if (ok && strcmp(argv[i], "-P") == 0) ok = parseCount(argv[i + 1], EACH_MAX_JOBS, &limit);
+        else if (ok && strcmp(argv[i], "-n") == 0) ok = parseCount(argv[i + 1], 4096, &maxItems);
+        else ok = false;
+        if (!ok) break;
+    }
+    if (i >= argc || argv[i][0] == '-') {
+        fprintf(stderr, "Invalid syntax!\n");
+        lastExitStatus = 1;
+        return -1;
+    }
+    // Looked up once: a missing command is reported once, not per line
+    if (resolveCommand(argv[i]) == NULL) {
+        fprintf(stderr, "Command not found!\n");
+        lastExitStatus = 127;
+        return -1;
+    }
+
+    pid_t leader = 0;
+    if (ownJob) {
+        fflush(stdout);
+        leader = fork();
+        if (leader < 0) {
+            perror("Fork failed");
+            return -1;
+        }
+        // A foreground job: the leader reads stdin at once, so both sides hand it the
+        // terminal before anyone can read from a background group and stop on SIGTTIN
+        if (leader > 0) {
+            setpgid(leader, leader);
+            if (isatty(STDIN_FILENO)) tcsetpgrp(STDIN_FILENO, leader);
+            return leader;
+        }
+        reaperChildInit();
+        setpgid(0, 0);
+        if (isatty(STDIN_FILENO)) tcsetpgrp(STDIN_FILENO, getpgrp()); // SIGTTOU still ignored here
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTSTP, SIG_DFL);
+        signal(SIGTTIN, SIG_DFL);
+        signal(SIGTTOU, SIG_DFL);
+    }
+
+    struct each_map map;
+    memset(&map, 0, sizeof(map));
+    map.templateCount = argc - i;
+    map.maxItems = maxItems;
+    map.limit = limit;
+    map.pgid = getpgrp();
+    map.argv = (char**)malloc((size_t)(map.templateCount + maxItems + 1) * sizeof(char*));
+    map.items = (size_t*)malloc((size_t)maxItems * sizeof(size_t));
+    map.pids = (pid_t*)calloc((size_t)limit, sizeof(pid_t));
+    map.devNull = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    if (map.argv == NULL || map.items == NULL || map.pids == NULL || map.devNull < 0) {
+        perror("each");
+        map.status = 1;
+    } else {
+        memcpy(map.argv, argv + i, (size_t)map.templateCount * sizeof(char*));
+        runMap(&map);
+    }
+    if (map.devNull >= 0) close(map.devNull);
+    free(map.argv);
+    free(map.items);
+    free(map.pids);
+    free(map.buf);
+
+    if (ownJob) exit(map.status);
+    lastExitStatus = map.status;
+    return 0;
+}
\ No newline at end of file
@@ -12,113 +12,65 @@ int pipe_exists;
 // Track the current job's process group when creating pipelines
 pid_t current_job_pgid = -1;
 
-struct bg_job* bg_job_head = NULL;
-int next_job_num = 1;
-
-int add_bg_job(pid_t pid, char* cmd_name) {
-    struct bg_job* node = malloc(sizeof(struct bg_job));
-    if (!node) return -1;
-    node->job_num = next_job_num++;
-    node->pid = pid;
-    node->cmd_name = strdup(cmd_name ? cmd_name : "(null)");
-    node->status = 0;
-    node->next = bg_job_head;
-    bg_job_head = node;
-    return node->job_num;
-}
+void (*foregroundWaitHook)(void) = NULL;
 
-// -------- Job helpers ---------
-static struct bg_job* find_bg_job_by_num(int job_num) {
-    struct bg_job* cur = bg_job_head;
-    while (cur) { if (cur->job_num == job_num) return cur; cur = cur->next; }
-    return NULL;
-}
+int lastExitStatus = 0;
 
-static struct bg_job* find_bg_job_by_pid(pid_t pid) {
-    struct bg_job* cur = bg_job_head;
-    while (cur) { if (cur->pid == pid) return cur; cur = cur->next; }
-    return NULL;
-}
+// Usage of the single stage executeCmdGroup is measuring, for waitForeground (see usage.h)
+static struct stage_usage* measuredStage = NULL;
 
-static int most_recent_job_num(void) {
-    int maxn = -1; struct bg_job* cur = bg_job_head;
-    while (cur) { if (cur->job_num > maxn) maxn = cur->job_num; cur = cur->next; }
-    return maxn;
+// Wait status -> shell exit status: the exit code, or 128 + the signal
+int exitStatusOf(int status) {
+    if (WIFEXITED(status)) return WEXITSTATUS(status);
+    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+    return 0; // stopped: not finished yet
 }
 
-static struct job* find_activity_job(pid_t pid) {
-    struct job* j = job_list; while (j) { if (j->pid == pid) return j; j = j->next; } return NULL;
+// Kill all known children/process groups (triggered on EOF).
+// Every job leads its own process group, and the job table holds each one exactly once
+// (keyed by pid, kept current as jobs are created and reaped), so this is one kill per job.
+void kill_all_children(void) {
+    for (struct job* j = job_list; j; j = j->next) {
+        if (j->pid <= 0) continue;
+        if (kill(-j->pid, SIGKILL) == -1) kill(j->pid, SIGKILL); // not a group leader (yet)
+    }
 }
 
-static int pid_seen_contains(pid_t *seen, int seen_count, pid_t pid) {
-    for (int i = 0; i < seen_count; i++) if (seen[i] == pid) return 1;
-    return 0;
+// Finished jobs, in the order the reaper saw them end, waiting for check_bg_jobs to report them
+static struct job* finished_head = NULL;
+static struct job* finished_tail = NULL;
+
+void jobStatusChanged(pid_t pid, int status) {
+    struct job* job = findJobByPid(pid);
+    if (!job) return; // e.g. a non-leader member of a stopped pipeline
+    if (WIFSTOPPED(status)) { job->running = 0; return; }
+    if (WIFCONTINUED(status)) { job->running = 1; return; }
+
+    // Terminated: gone from the table at once, completion message queued
+    detachJob(pid);
+    statsCount(STATS_JOBS_FINISHED);
+    // WIFEXITED - checks if proc exited via exit() or return from main
+    job->status = (WIFEXITED(status) && WEXITSTATUS(status) == 0) ? 1 : 2;
+    if (finished_tail) finished_tail->next = job; else finished_head = job;
+    finished_tail = job;
 }
 
-static void pid_seen_add(pid_t *seen, int *seen_count, pid_t pid, int max) {
-    if (pid <= 0) return;
-    if (pid_seen_contains(seen, *seen_count, pid)) return;
-    if (*seen_count < max) {
-        seen[*seen_count] = pid;
-        (*seen_count)++;
-    }
+int jobNotificationsPending(void) {
+    return finished_head != NULL;
 }
 
-// Kill all known children/process groups (triggered on EOF)
-void kill_all_children(void) {
-    // Collect unique PIDs from bg_job_head and job_list
-    pid_t seen[512];
-    int seen_count = 0;
-
-    // Iterate through bg jobs and jobs
-    // Add all jobs to the seen array, ensuring no duplicate additions
-    struct bg_job* bj = bg_job_head;
-    while (bj) { pid_seen_add(seen, &seen_count, bj->pid, (int)(sizeof(seen)/sizeof(seen[0]))); bj = bj->next; }
-
-    struct job* j = job_list;
-    while (j) { pid_seen_add(seen, &seen_count, j->pid, (int)(sizeof(seen)/sizeof(seen[0]))); j = j->next; }
-    
-    // Iterate through seen array  
-    for (int i = 0; i < seen_count; i++) {
-        pid_t pid = seen[i];
-        pid_t pg = getpgid(pid);
-        if (pg > 0) {
-            kill(-pg, SIGKILL); // If process is part of group, kill all processes in the group
-        } else {
-            kill(pid, SIGKILL);
-        }
-    }
-}
-
-// Before we take next command, sweep through current bg jobs 
 void check_bg_jobs() {
-    struct bg_job* prev = NULL;
-    struct bg_job* cur = bg_job_head;
-    while (cur) {
-        if (cur->status == 0) { // only poll running jobs
-            int status = 0;
-            pid_t result = waitpid(cur->pid, &status, WNOHANG);
-            if (result > 0) {
-                // WIFEXITED - checks if proc exited via exit() or return from main
-                if (WIFEXITED(status) && WEXITSTATUS(status)==0) {
-                    cur->status = 1; // exited normally
-                } else {
-                    cur->status = 2; // exited abnormally
-                }
-                print_bg_job_status(cur->job_num, cur->pid, cur->cmd_name, cur->status);
-                // Remove node immediately after reporting
-                struct bg_job* to_free = cur;
-                if (prev) prev->next = cur->next; else bg_job_head = cur->next; // Deleting fist node edge case
-                cur = cur->next;
-                free(to_free->cmd_name);
-                free(to_free);
-                continue;
-            }
-        }
-        // If waitpid says job did not terminate yet, move on to other jobs in LL
-        prev = cur;
-        cur = cur->next;
+    // Collect whatever ended since the last call, then print exit messages in order
+    uint64_t start = statsNow();
+    reapChildren();
+    while (finished_head) {
+        struct job* done = finished_head;
+        finished_head = done->next;
+        if (finished_head == NULL) finished_tail = NULL;
+        print_bg_job_status(done->job_num, done->pid, done->command, done->status);
+        freeJob(done);
     }
+    statsRecord(STATS_JOBS, start);
 }
 
 void print_bg_job_status(int job_num, pid_t pid, char* cmd_name, int status) {
@@ -130,76 +82,134 @@ void print_bg_job_status(int job_num, pid_t pid, char* cmd_name, int status) {
 }
 
 int is_bg_job_running(pid_t pid) {
-    struct bg_job* cur = bg_job_head;
-    while (cur) {
-        if (cur->pid == pid && cur->status == 0) return 1;
-        cur = cur->next;
-    }
-    return 0;
+    struct job* job = findJobByPid(pid);
+    return job != NULL && job->status == 0;
 }
 
-void executeShellCommand(struct shell_cmd* shellCommandStruct){
+void executeShellCommand(const struct plan* plan){
+    statsEnd(STATS_DISPATCH); // a line read at the prompt or from a script has started
     bg_fork = 0;
     pipe_exists = 0;
-    // Just a safety net to check invalid shell_cmd again
-    if (!shellCommandStruct || shellCommandStruct->validity == false || shellCommandStruct->cmdArrIndex==0) return;
-    int num_cmdGroups = shellCommandStruct->cmdArrIndex;
-
-    // Loop through each cmdGroup in the cmdGroupArr
-    for (int i = 0; i < num_cmdGroups; i++) {
-        struct cmd_group* cmdGroup = shellCommandStruct->cmdGroupArr[i];
-        if (cmdGroup && cmdGroup->validity) {
-            // Check separator exists at this index and whether it's '&' for background
-            if (i < shellCommandStruct->sepArrIndex && strcmp(shellCommandStruct->separatorArr[i], "&") == 0) {
-                // If "cmd_group &", need to run in BG, fork a new process
-                pid_t jobLeaderPid = fork();
-                if (jobLeaderPid < 0) {
-                    perror("Fork failed");
-                } else if (jobLeaderPid == 0) {
-                    // In child: set background flag and redirect stdin to /dev/null
-                    bg_fork = 1; // Happens in child's memory address space only
-
-                    // Create a new process group for the background job; child becomes group leader
-                    setpgid(0, 0); // Prevents signals sent to shell's fg group being recieved to BG processes if they are put in a new group
-                    current_job_pgid = getpid();
-                    // Reset default signal handling for the job
-                    signal(SIGINT, SIG_DFL);
-                    signal(SIGTSTP, SIG_DFL);
-                    signal(SIGTTIN, SIG_DFL);
-                    signal(SIGTTOU, SIG_DFL);
-                    int devnull = open("/dev/null", O_RDONLY);
-                    if (devnull >= 0) {
-                        // Make the FD STDIN refer to same FD as devnull so that this child bg process does not take input from terminal
-                        dup2(devnull, STDIN_FILENO);
-                        close(devnull);
-                    }
-                    // Execute the command group
-                    executeCmdGroup(cmdGroup); // Will run as BG (setup done here)
-                    exit(0); // Exit child process after execution
-                } else {
-                    // Parent: add to background jobs and print info
-                    char* cmd_name = cmdGroup->cmdString ? cmdGroup->cmdString : "background job";
-                    int job_num = add_bg_job(jobLeaderPid, cmd_name);
-                    // Also add to shell (parent of this child) process' job list data structure (parent) so activities can see it
-                    addJob(jobLeaderPid, cmd_name, 1);
-                    if (job_num != -1) printf("[%d] %d\n", job_num, jobLeaderPid);
-                    fflush(stdout);
+    pathCacheRevalidate(); // PATH directories are checked at most once per command line
+    // Only valid commands are ever compiled into a plan
+    if (!plan || plan->nodeCount == 0) return;
+
+    // Each group node is followed by its stage nodes; jump from group to group
+    for (int i = 0; i < plan->nodeCount; i += plan->nodes[i].stageCount + 1) {
+        const struct plan_node* cmdGroup = &plan->nodes[i];
+        if (cmdGroup->op == OP_GROUP_PAR) {
+            // "a &&& b &&& c": the batch runs up to and including the first group not followed by &&&
+            const struct plan_node* batch[plan->nodeCount];
+            int count = 0;
+            batch[count++] = cmdGroup;
+            while (cmdGroup->op == OP_GROUP_PAR && i + cmdGroup->stageCount + 1 < plan->nodeCount) {
+                i += cmdGroup->stageCount + 1;
+                cmdGroup = &plan->nodes[i];
+                batch[count++] = cmdGroup;
+            }
+            executeParallel(batch, count, cmdGroup->op == OP_GROUP_BG);
+        } else if (cmdGroup->op == OP_GROUP_BG) {
+            // If "cmd_group &", need to run in BG, fork a new process
+            fflush(stdout); // the child must not inherit (and later flush) our buffered output
+            pid_t jobLeaderPid = fork();
+            if (jobLeaderPid < 0) {
+                perror("Fork failed");
+            } else if (jobLeaderPid == 0) {
+                // In child: set background flag and redirect stdin to /dev/null
+                bg_fork = 1; // Happens in child's memory address space only
+                reaperChildInit();
+
+                // Create a new process group for the background job; child becomes group leader
+                setpgid(0, 0); // Prevents signals sent to shell's fg group being recieved to BG processes if they are put in a new group
+                current_job_pgid = getpid();
+                // Reset default signal handling for the job
+                signal(SIGINT, SIG_DFL);
+                signal(SIGTSTP, SIG_DFL);
+                signal(SIGTTIN, SIG_DFL);
+                signal(SIGTTOU, SIG_DFL);
+                int devnull = open("/dev/null", O_RDONLY);
+                if (devnull >= 0) {
+                    // Make the FD STDIN refer to same FD as devnull so that this child bg process does not take input from terminal
+                    dup2(devnull, STDIN_FILENO);
+                    close(devnull);
                 }
+                // Execute the command group
+                executeCmdGroup(cmdGroup); // Will run as BG (setup done here)
+                exit(0); // Exit child process after execution
             } else {
-                // Sequential execution: execute and block until done
-                executeCmdGroup(cmdGroup);
+                // Parent: also put the leader in its own group, so the group exists
+                // before anyone (e.g. kill_all_children) signals it
+                setpgid(jobLeaderPid, jobLeaderPid);
+                // Parent: add to background jobs and print info
+                char* cmd_name = cmdGroup->text ? cmdGroup->text : "background job";
+                // One table entry serves the bg list, fg/bg and activities
+                int job_num = addJob(jobLeaderPid, cmd_name, 1);
+                if (job_num != -1) printf("[%d] %d\n", job_num, jobLeaderPid);
+                fflush(stdout);
             }
+        } else {
+            // Sequential execution: execute and block until done
+            executeCmdGroup(cmdGroup);
         }
     }
 }
 
-void executeCmdGroup(struct cmd_group* cmdGroupStruct) {
-    if (!cmdGroupStruct || cmdGroupStruct->validity == false || cmdGroupStruct->atomicArrIndex == 0) return;
-    int num_atomics = cmdGroupStruct->atomicArrIndex;
+// "time cmd": the same stage without its first word
+static void stripTime(struct plan_node* stage) {
+    stage->argv++;
+    stage->argc--;
+    stage->builtin = (stage->argc > 0) ? lookupBuiltin(stage->argv[0]) : BUILTIN_NONE;
+    // The text is a view into the line; leave it alone unless it starts with the word
+    if (stage->text == NULL) return;
+    int skip = 0;
+    while (skip < stage->textLength && (stage->text[skip] == ' ' || stage->text[skip] == '\t')) skip++;
+    if (skip + 4 > stage->textLength || strncmp(stage->text + skip, "time", 4) != 0) return;
+    skip += 4;
+    while (skip < stage->textLength && (stage->text[skip] == ' ' || stage->text[skip] == '\t')) skip++;
+    stage->text += skip;
+    stage->textLength -= skip;
+}
+
+// A measured foreground group is done: report it for "time", and count it for the line
+static void finishMeasured(const struct plan_node* stages, const struct stage_usage* usages, int count, bool timed) {
+    if (timed) usageReport(stages, usages, count);
+    usageLineAdd(usages, count);
+}
+
+void executeCmdGroup(const struct plan_node* cmdGroupStruct) {
+    if (!cmdGroupStruct || cmdGroupStruct->stageCount == 0) return;
+    int num_atomics = cmdGroupStruct->stageCount;
+    const struct plan_node* stages = cmdGroupStruct + 1; // stage nodes follow the group node
+
+    // "time" in front of a stage: run the stages without it (plans are shared, so on a copy)
+    bool timed = false;
+    for (int i = 0; i < num_atomics; i++) {
+        if (stages[i].builtin == BUILTIN_TIME) timed = true;
+    }
+    struct plan_node stripped[timed ? num_atomics : 1];
+    if (timed) {
+        memcpy(stripped, stages, num_atomics * sizeof(struct plan_node));
+        for (int i = 0; i < num_atomics; i++) {
+            while (stripped[i].builtin == BUILTIN_TIME) stripTime(&stripped[i]);
+        }
+        stages = stripped;
+    }
+    // Only foreground groups are measured, and a builtin's nested commands are part of its own cost
+    bool measure = !bg_fork && (timed || timingAlways) && measuredStage == NULL;
 
     // If only one atomic, no pipes needed so no need any more forks also
     if (num_atomics == 1) {
-        executeAtomicCmd(cmdGroupStruct->atomicArr[0]);
+        struct stage_usage usage;
+        if (measure) {
+            usageShellBegin(&usage); // replaced by the child's own usage if one is waited on
+            measuredStage = &usage;
+        }
+        executeAtomicCmd(&stages[0]);
+        if (measure) {
+            measuredStage = NULL;
+            if (!usage.measured && !usage.stopped) usageShellEnd(&usage);
+            if (usage.measured) finishMeasured(stages, &usage, 1, timed);
+        }
         return;
     }
 
@@ -218,13 +228,31 @@ void executeCmdGroup(struct cmd_group* cmdGroupStruct) {
     // the user only expects background (&) jobs there. Foreground pipeline
     // children are waited on immediately below.
     pid_t pids[num_atomics];
+    struct stage_usage usages[num_atomics];
     pid_t pgid = -1;
     for (int i = 0; i < num_atomics; i++) {
-        struct atomic* atomicCmd = cmdGroupStruct->atomicArr[i];
-        if (!atomicCmd || !atomicCmd->validity) continue;
+        const struct plan_node* atomicCmd = &stages[i];
+        if (measure) usageStart(&usages[i]);
+
+        // External stages need no shell code in the child: spawn them without copying the shell
+        if (launchBackend != LAUNCH_FORK && atomicCmd->builtin == BUILTIN_NONE && atomicCmd->argc > 0) {
+            pid_t group = bg_fork ? (current_job_pgid > 0 ? current_job_pgid : 0) : (pgid > 0 ? pgid : 0);
+            pids[i] = spawnStage(atomicCmd, (i > 0) ? pipes[i-1][0] : -1,
+                                 (i < num_atomics - 1) ? pipes[i][1] : -1,
+                                 group, &pipes[0][0], 2 * (num_atomics - 1));
+            if (!bg_fork && pgid <= 0 && pids[i] > 0) pgid = pids[i];
+            continue;
+        }
+
+        // Resolve in the shell so the cache keeps the result; the child then hits it
+        if (atomicCmd->builtin == BUILTIN_NONE && atomicCmd->argc > 0) resolveCommand(atomicCmd->argv[0]);
 
+        fflush(stdout);
+        uint64_t launchStart = statsNow();
         pids[i] = fork();
+        if (pids[i] > 0) statsRecord(STATS_LAUNCH, launchStart);
         if (pids[i] == 0) {
+            reaperChildInit();
             // Child: Set up pipe connections
             // Put this child in the job's process group
             if (bg_fork) {
@@ -256,16 +284,13 @@ void executeCmdGroup(struct cmd_group* cmdGroupStruct) {
 
             // Execute the atomic
             executeAtomicCmd(atomicCmd);
-            exit(0);  // Exit child after execution
+            fflush(stdout);
+            exit(lastExitStatus);  // Exit child after execution (builtins that did not exec)
         } else {
             // Parent: set up process group id for the pipeline in shell process' memory too
             if (!bg_fork) {
-                if (i == 0) {
-                    pgid = pids[0];
-                    setpgid(pids[0], pgid);
-                } else {
-                    setpgid(pids[i], pgid);
-                }
+                if (pgid <= 0) pgid = pids[i]; // first child to start leads the group
+                setpgid(pids[i], pgid);
             }
         }
     }
@@ -280,29 +305,27 @@ void executeCmdGroup(struct cmd_group* cmdGroupStruct) {
     if (!bg_fork) {
         // Hand terminal to the pipeline's process group
         if (isatty(STDIN_FILENO) && pgid > 0) tcsetpgrp(STDIN_FILENO, pgid);
-        int status;
+        int statuses[num_atomics];
         int any_stopped = 0;
-        // Check if any atomic command in pipeline got stopped
+        if (foregroundWaitHook) foregroundWaitHook();
+        // Wait for every stage to exit or stop; check if any atomic command in pipeline got stopped
+        reaperWaitPidsUsage(pids, num_atomics, statuses, measure ? usages : NULL);
         for (int i = 0; i < num_atomics; i++) {
-            if (pids[i] > 0) {
-                if (waitpid(pids[i], &status, WUNTRACED) > 0) {
-                    if (WIFSTOPPED(status)) any_stopped = 1;
-                }
-            }
+            if (pids[i] > 0 && WIFSTOPPED(statuses[i])) any_stopped = 1;
         }
+        if (measure && !any_stopped) finishMeasured(stages, usages, num_atomics, timed);
+        lastExitStatus = (pids[num_atomics - 1] > 0) ? exitStatusOf(statuses[num_atomics - 1]) : 127;
         // If pipeline stopped, announce and register as background-controllable job
         if (any_stopped && pgid > 0) {
-            const char* name = cmdGroupStruct->cmdString ? cmdGroupStruct->cmdString : "job";
-            struct bg_job* existing = find_bg_job_by_pid(pgid);
+            const char* name = cmdGroupStruct->text ? cmdGroupStruct->text : "job";
+            struct job* existing = findJobByPid(pgid);
             int job_num;
             if (existing) {
                 job_num = existing->job_num;
+                existing->running = 0;
             } else {
-                job_num = add_bg_job(pgid, (char*)name);
+                job_num = addJob(pgid, (char*)name, 0);
             }
-            // Update activities: ensure present, if not create, marked stopped
-            struct job* aj = find_activity_job(pgid);
-            if (!aj) addJob(pgid, (char*)name, 0); else aj->running = 0;
             if (job_num != -1) {
                 printf("[%d] Stopped %s\n", job_num, name);
                 fflush(stdout);
@@ -311,136 +334,176 @@ void executeCmdGroup(struct cmd_group* cmdGroupStruct) {
         // Reclaim terminal control
         if (isatty(STDIN_FILENO)) tcsetpgrp(STDIN_FILENO, getpgrp());
     } else {
-        // Background pipeline: nothing to wait here; job leader handles listing
+        // Background pipeline: the job leader stays until every stage is gone, so the
+        // job (and its process group in the job table) lives exactly as long as the pipeline
+        int statuses[num_atomics];
+        reaperWaitPids(pids, num_atomics, statuses);
+        lastExitStatus = (pids[num_atomics - 1] > 0) ? exitStatusOf(statuses[num_atomics - 1]) : 127;
     }
     // Clear pipe_exists flag after pipeline completes
     pipe_exists = 0;
 }
 
-void executeAtomicCmd(struct atomic* atomicCmdStruct) {
-    if (!atomicCmdStruct || atomicCmdStruct->validity == 0 || atomicCmdStruct->termArrIndex == 0) return;
+// Open and dup2 every redirection in order (the last one for each fd wins); -1 once an open fails
+static int applyRedirections(const struct plan_node* stage) {
+    for (int i = 0; i < stage->redirCount; i++) {
+        const struct redir* r = &stage->redirs[i];
+        int fd = openRedirTarget(r);
+        if (fd < 0) { perror(""); return -1; }
+        dup2(fd, r->target_fd);
+        close(fd);
+    }
+    return 0;
+}
+
+// Parent side of a standalone foreground command: give the terminal to the child's
+// process group and wait; on stop, keep it in activities and the bg list
+static void waitForeground(pid_t pid, const struct plan_node* atomicCmdStruct) {
+    char* cmd = atomicCmdStruct->argv[0];
+    if (isatty(STDIN_FILENO)) tcsetpgrp(STDIN_FILENO, pid);
+    int status = 0;
+    if (foregroundWaitHook) foregroundWaitHook();
+    reaperWaitPidsUsage(&pid, 1, &status, measuredStage);
+    if (isatty(STDIN_FILENO)) tcsetpgrp(STDIN_FILENO, getpgrp());
+    lastExitStatus = exitStatusOf(status);
+    if (WIFSTOPPED(status)) {
+        // Add stopped foreground job to activities and bg list; announce
+        // The stage text is a view into the line, make a terminated copy for the job lists
+        char* name = atomicCmdStruct->text
+            ? strndup(atomicCmdStruct->text, atomicCmdStruct->textLength) : strdup(cmd);
+        int job_num = addJob(pid, name ? name : cmd, 0);
+        if (job_num != -1) {
+            printf("[%d] Stopped %s\n", job_num, name ? name : cmd);
+            fflush(stdout);
+        }
+        free(name);
+    }
+}
 
+void executeAtomicCmd(const struct plan_node* atomicCmdStruct) {
     // Immedaitely return if the first command is empty
-    struct terminal* firstTerm = atomicCmdStruct->terminalArr[0];
-    if (!firstTerm || firstTerm->cmdAndArgsIndex == 0) return;
+    if (!atomicCmdStruct || atomicCmdStruct->argc == 0) return;
 
     // --- Prepare first command and args ---
-    char** args = firstTerm->cmdAndArgs;
+    char** args = atomicCmdStruct->argv;
     char* cmd = args[0];
-
-    // --- Detect builtins ---
-    int is_builtin = (!strcmp(cmd, "hop") || !strcmp(cmd, "reveal") 
-    || !strcmp(cmd, "log") || !strcmp(cmd, "activities") || !strcmp(cmd, "ping")
-    || !strcmp(cmd, "fg") || !strcmp(cmd, "bg") || !strcmp(cmd, "exit"));
-
-    // --- Save original stdin/stdout for restoration ---
-    int original_stdin  = dup(STDIN_FILENO);
-    int original_stdout = dup(STDOUT_FILENO);
-    if (original_stdin < 0 || original_stdout < 0) {
-        perror("dup failed");
+    int argc = atomicCmdStruct->argc;
+
+    // --- Builtins were resolved when the plan was compiled ---
+    int builtin = atomicCmdStruct->builtin;
+    int is_builtin = (builtin != BUILTIN_NONE);
+    lastExitStatus = 0;
+
+    // --- Standalone external command, spawn backend: the child gets its own redirections ---
+    if (!is_builtin && !pipe_exists && !bg_fork && launchBackend != LAUNCH_FORK) {
+        pid_t pid = spawnStage(atomicCmdStruct, -1, -1, 0, NULL, 0);
+        if (pid > 0) waitForeground(pid, atomicCmdStruct);
+        else lastExitStatus = 127;
         return;
     }
 
-    // --- Apply all redirections ---
-    for (int i = 0; i < atomicCmdStruct->sepArrIndex - 1; i++) {
-        char* sep = atomicCmdStruct->separatorArr[i];
-        struct terminal* fnameTerm = atomicCmdStruct->terminalArr[i+1];
-
-        if (!sep || !fnameTerm || fnameTerm->cmdAndArgsIndex == 0) continue;
-        char* filename = fnameTerm->cmdAndArgs[0];
-
-        if (strcmp(sep, "<") == 0) {
-            int fd_in = open(filename, O_RDONLY);
-            if (fd_in < 0) { perror(""); goto restore; }
-            dup2(fd_in, STDIN_FILENO);
-            close(fd_in);
-        } else if (strcmp(sep, ">") == 0) {
-            int fd_out = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
-            if (fd_out < 0) { perror(""); goto restore; }
-            dup2(fd_out, STDOUT_FILENO);
-            close(fd_out);
-        } else if (strcmp(sep, ">>") == 0) {
-            int fd_out = open(filename, O_WRONLY | O_CREAT | O_APPEND, 0644);
-            if (fd_out < 0) { perror(""); goto restore; }
-            dup2(fd_out, STDOUT_FILENO);
-            close(fd_out);
+    // --- Redirections are applied only in the process that runs the command ---
+    // Only a builtin running inside the shell itself has stdin/stdout to give back afterwards;
+    // the saved copies are close-on-exec so commands started by the builtin never see them
+    pid_t eachLeader = 0; // each run by the shell itself gets a leader of its own
+    int restoreFds = is_builtin && atomicCmdStruct->redirCount > 0 && !pipe_exists && !bg_fork;
+    int original_stdin = -1;
+    int original_stdout = -1;
+    if (restoreFds) {
+        fflush(stdout); // earlier output belongs to the old stdout
+        original_stdin  = fcntl(STDIN_FILENO, F_DUPFD_CLOEXEC, 10);
+        original_stdout = fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 10);
+        if (original_stdin < 0 || original_stdout < 0) {
+            perror("dup failed");
+            if (original_stdin >= 0) close(original_stdin);
+            if (original_stdout >= 0) close(original_stdout);
+            return;
         }
-        // ensures only last redirection of each type is applied
+    }
+    if ((is_builtin || pipe_exists || bg_fork) && applyRedirections(atomicCmdStruct) < 0) {
+        lastExitStatus = 1;
+        goto restore;
     }
 
     // --- Execute ---
     if (is_builtin) {
         // Builtins run directly in the current process (unless you want subshell semantics)
-        if (!strcmp(cmd, "hop"))        executeHop(atomicCmdStruct);
-        else if (!strcmp(cmd, "reveal")) executeReveal(atomicCmdStruct);
-        else if (!strcmp(cmd, "log"))    executeLog(atomicCmdStruct);
-        else if (!strcmp(cmd, "activities")) printActivities();
-        else if (!strcmp(cmd, "ping"))   executePing(atomicCmdStruct);
-        else if (!strcmp(cmd, "fg")) {
+        if (builtin == BUILTIN_HOP)             executeHop(argc, args);
+        else if (builtin == BUILTIN_REVEAL)     executeReveal(argc, args);
+        else if (builtin == BUILTIN_LOG)        executeLog(argc, args);
+        else if (builtin == BUILTIN_ACTIVITIES) printActivities();
+        else if (builtin == BUILTIN_PING)       executePing(argc, args);
+        else if (builtin == BUILTIN_CACHE)      executeCache(argc, args);
+        else if (builtin == BUILTIN_LAUNCH)     executeLaunch(argc, args);
+        else if (builtin == BUILTIN_HASH)       executeHash(argc, args);
+        else if (builtin == BUILTIN_TIMING)     executeTiming(argc, args);
+        else if (builtin == BUILTIN_STATS)      executeStats(argc, args);
+        else if (builtin == BUILTIN_EACH)       eachLeader = executeEach(argc, args, !pipe_exists && !bg_fork);
+        else if (builtin == BUILTIN_FG) {
             // fg [job_number] command
             int job_num = -1;
-            if (firstTerm->cmdAndArgsIndex == 1) {
-                job_num = most_recent_job_num();
-            } else if (firstTerm->cmdAndArgsIndex == 2) {
+            if (argc == 1) {
+                job_num = mostRecentJob() ? mostRecentJob()->job_num : -1;
+            } else if (argc == 2) {
                 char *end = NULL; long jn = strtol(args[1], &end, 10);
                 if (end == args[1] || *end != '\0' || jn <= 0) { fprintf(stderr, "Invalid syntax!\n"); goto restore; }
                 job_num = (int)jn;
             } else { fprintf(stderr, "Invalid syntax!\n"); goto restore; }
 
-            struct bg_job* bj = find_bg_job_by_num(job_num);
+            struct job* bj = findJobByNum(job_num);
             if (!bj) { printf("No such job\n"); goto restore; }
             pid_t pid = bj->pid;
             pid_t pg = getpgid(pid);
             if (pg < 0) { printf("No such job\n"); goto restore; }
 
             // Print the entire command when bringing to foreground
-            if (bj->cmd_name) { printf("%s\n", bj->cmd_name); fflush(stdout); }
+            if (bj->command) { printf("%s\n", bj->command); fflush(stdout); }
 
             // Give terminal to job's process group and continue it
             if (isatty(STDIN_FILENO)) tcsetpgrp(STDIN_FILENO, pg);
             kill(-pg, SIGCONT);
+            bj->running = 1;
             // Wait for job leader to finish or stop again
-            int status; if (waitpid(pid, &status, WUNTRACED) < 0 && errno != ECHILD) { /* ignore */ }
+            int status; reaperWaitPids(&pid, 1, &status);
             if (isatty(STDIN_FILENO)) tcsetpgrp(STDIN_FILENO, getpgrp());
 
-            // Update activities list based on status
-            struct job* aj = find_activity_job(pid);
+            // Update the job based on status
             if (WIFSTOPPED(status)) {
-                if (aj) aj->running = 0; else addJob(pid, bj->cmd_name ? bj->cmd_name : "job", 0);
-                // Do not duplicate bg job entry or change job number here
-                printf("[%d] Stopped %s\n", job_num, bj->cmd_name ? bj->cmd_name : "job");
+                // Same job number, same entry
+                bj->running = 0;
+                printf("[%d] Stopped %s\n", job_num, bj->command);
                 fflush(stdout);
             } else {
-                if (aj) removeJob(pid);
+                // Finished in the foreground: nothing left to report for it
+                removeJob(pid);
             }
         }
-        else if (!strcmp(cmd, "bg")) {
+        else if (builtin == BUILTIN_BG) {
             // bg [job_number]
             int job_num = -1;
-            if (firstTerm->cmdAndArgsIndex == 1) {
-                job_num = most_recent_job_num();
-            } else if (firstTerm->cmdAndArgsIndex == 2) {
+            if (argc == 1) {
+                job_num = mostRecentJob() ? mostRecentJob()->job_num : -1;
+            } else if (argc == 2) {
                 char *end = NULL; long jn = strtol(args[1], &end, 10);
                 if (end == args[1] || *end != '\0' || jn <= 0) { fprintf(stderr, "Invalid syntax!\n"); goto restore; }
                 job_num = (int)jn;
             } else { fprintf(stderr, "Invalid syntax!\n"); goto restore; }
 
-            struct bg_job* bj = find_bg_job_by_num(job_num);
+            struct job* bj = findJobByNum(job_num);
             if (!bj) { printf("No such job\n"); goto restore; }
             pid_t pid = bj->pid; pid_t pg = getpgid(pid);
             if (pg < 0) { printf("No such job\n"); goto restore; }
 
             // Only resume stopped jobs
-            struct job* aj = find_activity_job(pid);
-            if (aj && aj->running == 1) { printf("Job already running\n"); goto restore; }
+            if (bj->running == 1) { printf("Job already running\n"); goto restore; }
             // Resume
             if (kill(-pg, SIGCONT) == -1) { printf("No such job\n"); goto restore; }
-            if (aj) aj->running = 1; else addJob(pid, bj->cmd_name ? bj->cmd_name : "job", 1);
+            bj->running = 1;
             // Print per spec
-            printf("[%d] %s &\n", job_num, bj->cmd_name ? bj->cmd_name : "job");
+            printf("[%d] %s &\n", job_num, bj->command);
             fflush(stdout);
         }
-        else if (!strcmp(cmd, "exit"))   exit(0);
+        else if (builtin == BUILTIN_EXIT)       exit(0);
 
     }
     else if (pipe_exists || bg_fork) {
@@ -452,17 +515,25 @@ void executeAtomicCmd(struct atomic* atomicCmdStruct) {
         signal(SIGTSTP, SIG_DFL);
         signal(SIGTTIN, SIG_DFL);
         signal(SIGTTOU, SIG_DFL);
-        execvp(cmd, args);
+        const char* path = resolveCommand(cmd);
+        if (path) execv(path, args);
+        execvp(cmd, args); // not on PATH, or execv failed (e.g. a script without #!)
         fprintf(stderr, "Command not found!\n");
+        lastExitStatus = 127;
     }
     else {
         // Standalone external command: fork + exec
+        const char* path = resolveCommand(cmd);
+        fflush(stdout);
+        uint64_t launchStart = statsNow();
         pid_t pid = fork();
+        if (pid > 0) statsRecord(STATS_LAUNCH, launchStart);
         if (pid < 0) {
             perror("fork failed");
             goto restore;
         } else if (pid == 0) {
             //execvp("/bin/bash", (char*[]){"/bin/bash", "-c", atomicCmdStruct->atomicString, NULL});
+            reaperChildInit();
             // Child: new process group for job-control
             setpgid(0, 0);
             // Foreground job should take default signal actions
@@ -470,43 +541,32 @@ void executeAtomicCmd(struct atomic* atomicCmdStruct) {
             signal(SIGTSTP, SIG_DFL);
             signal(SIGTTIN, SIG_DFL);
             signal(SIGTTOU, SIG_DFL);
+            if (applyRedirections(atomicCmdStruct) < 0) exit(1);
+            if (path) execv(path, args);
             execvp(cmd, args);
             fprintf(stderr, "Command not found!\n");
             exit(1);
         } else {
-            // Parent: give terminal to child's process group and wait; on stop, keep in activities
-            if (isatty(STDIN_FILENO)) tcsetpgrp(STDIN_FILENO, pid);
-            int status = 0;
-            waitpid(pid, &status, WUNTRACED);
-            if (isatty(STDIN_FILENO)) tcsetpgrp(STDIN_FILENO, getpgrp());
-            if (WIFSTOPPED(status)) {
-                // Add stopped foreground job to activities and bg list; announce
-                const char* name = atomicCmdStruct->atomicString ? atomicCmdStruct->atomicString : cmd;
-                int job_num = add_bg_job(pid, (char*)name);
-                addJob(pid, (char*)name, 0);
-                if (job_num != -1) {
-                    printf("[%d] Stopped %s\n", job_num, name);
-                    fflush(stdout);
-                }
-            }
+            waitForeground(pid, atomicCmdStruct);
         }
     }
 
     // --- Restore original FDs ---
 restore:
-    dup2(original_stdin, STDIN_FILENO);
-    dup2(original_stdout, STDOUT_FILENO);
-    close(original_stdin);
-    close(original_stdout);
+    if (restoreFds) {
+        fflush(stdout); // the builtin's buffered output belongs to the redirected stdout
+        dup2(original_stdin, STDIN_FILENO);
+        dup2(original_stdout, STDOUT_FILENO);
+        close(original_stdin);
+        close(original_stdout);
+    }
+    // Waited on like any foreground command, once the terminal is stdin again
+    if (eachLeader > 0) waitForeground(eachLeader, atomicCmdStruct);
 }
 
 
-void executeActivities(struct atomic* atomicCmdStruct) {
-    if (!atomicCmdStruct || atomicCmdStruct->validity == 0 || atomicCmdStruct->termArrIndex == 0) return;
-
-    struct terminal* firstTerm = atomicCmdStruct->terminalArr[0];
-    if (!firstTerm || firstTerm->cmdAndArgsIndex == 0) return;
-    char** args = firstTerm->cmdAndArgs;
+void executeActivities(int argc, char** args) {
+    if (argc == 0) return;
     char* cmd = args[0];
 
     if (strcmp(cmd, "activities") == 0) {
@@ -517,16 +577,12 @@ void executeActivities(struct atomic* atomicCmdStruct) {
 }
 
 
-void executePing(struct atomic* atomicCmdStruct){
-    if (!atomicCmdStruct || atomicCmdStruct->validity == 0 || atomicCmdStruct->termArrIndex == 0) return;
-
-    struct terminal* firstTerm = atomicCmdStruct->terminalArr[0];
-    if (!firstTerm || firstTerm->cmdAndArgsIndex == 0) return;
-    char** args = firstTerm->cmdAndArgs;
+void executePing(int argc, char** args){
+    if (argc == 0) return;
     (void)args[0]; // command name "ping" unused beyond presence
 
     // Expect exactly: ping <pid> <signal_number>
-    if (firstTerm->cmdAndArgsIndex != 3) {
+    if (argc != 3) {
         fprintf(stderr, "Invalid syntax!\n");
         return;
     }
@@ -0,0 +1,164 @@
+#include "../include/histindex.h"
+#include "../include/history.h"
+
+#define HISTORY_GRAM_USED (1u << 24)
+
+static struct gram_postings* table = NULL;
+static uint32_t bucketCount = 0;
+static uint32_t usedBuckets = 0;
+static bool indexReady = false;
+static uint64_t indexBase = 0;   // ids are sequence numbers minus this
+static uint64_t indexedUpTo = 0; // next sequence number to index
+
+
+static uint32_t gramAt(const char* s){
+    return (uint32_t)(unsigned char)s[0] << 16 | (uint32_t)(unsigned char)s[1] << 8 | (unsigned char)s[2];
+}
+
+static uint32_t gramHash(uint32_t gram){
+    return (gram * 2654435761u) >> 7;
+}
+
+static struct gram_postings* findGram(uint32_t gram){
+    if (bucketCount == 0) return NULL;
+    uint32_t key = gram | HISTORY_GRAM_USED;
+    for (uint32_t i = gramHash(gram) & (bucketCount - 1); ; i = (i + 1) & (bucketCount - 1)) {
+        if (table[i].key == key) return &table[i];
+        if (table[i].key == 0) return NULL;
+    }
+}
+
+static bool growTable(void){
+    uint32_t newCount = bucketCount ? bucketCount * 2 : HISTORY_INDEX_MIN_BUCKETS;
+    struct gram_postings* newTable = (struct gram_postings*)calloc(newCount, sizeof(struct gram_postings));
+    if (newTable == NULL) return false;
+    for (uint32_t b = 0; b < bucketCount; b++) {
+        if (table[b].key == 0) continue;
+        uint32_t i = gramHash(table[b].key & ~HISTORY_GRAM_USED) & (newCount - 1);
+        while (newTable[i].key != 0) i = (i + 1) & (newCount - 1);
+        newTable[i] = table[b];
+    }
+    free(table);
+    table = newTable;
+    bucketCount = newCount;
+    return true;
+}
+
+static struct gram_postings* insertGram(uint32_t gram){
+    struct gram_postings* postings = findGram(gram);
+    if (postings != NULL) return postings;
+    if ((usedBuckets + 1) * 10 > bucketCount * 7 && !growTable()) return NULL;
+
+    uint32_t i = gramHash(gram) & (bucketCount - 1);
+    while (table[i].key != 0) i = (i + 1) & (bucketCount - 1);
+    table[i].key = gram | HISTORY_GRAM_USED;
+    usedBuckets++;
+    return &table[i];
+}
+
+static void addId(struct gram_postings* postings, uint32_t seq){
+    // A gram repeated within one entry is listed once
+    if (postings->len > postings->start && postings->ids[postings->len - 1] == seq) return;
+    if (postings->len == postings->cap) {
+        if (postings->start > postings->len / 2) {
+            // Mostly dropped entries at the front: slide down instead of growing
+            postings->len -= postings->start;
+            memmove(postings->ids, postings->ids + postings->start, postings->len * sizeof(uint32_t));
+            postings->start = 0;
+        } else {
+            uint32_t newCap = postings->cap ? postings->cap * 2 : 4;
+            uint32_t* newIds = (uint32_t*)realloc(postings->ids, newCap * sizeof(uint32_t));
+            if (newIds == NULL) return;
+            postings->ids = newIds;
+            postings->cap = newCap;
+        }
+    }
+    postings->ids[postings->len++] = seq;
+}
+
+static void indexEntry(uint32_t seq, const char* commandString){
+    size_t len = strlen(commandString);
+    for (size_t i = 0; i + 3 <= len; i++) {
+        struct gram_postings* postings = insertGram(gramAt(commandString + i));
+        if (postings != NULL) addId(postings, seq);
+    }
+}
+
+// Index every entry appended (by any shell) since the last search
+static void catchUp(void){
+    uint64_t next = historyNextSeq();
+    uint64_t oldest = historyOldestSeq();
+    if (indexReady && next - indexBase > UINT32_MAX) historyIndexClear();
+    if (!indexReady) {
+        indexBase = indexedUpTo = oldest;
+        indexReady = true;
+    }
+    if (indexedUpTo < oldest) indexedUpTo = oldest;
+
+    uint64_t seq;
+    for (seq = indexedUpTo; seq < next; seq++) {
+        const char* entry = historyEntryBySeq(seq);
+        if (entry == NULL) {
+            // Most likely still being written by another shell: pick it up next time
+            if (next - seq <= HISTORY_INDEX_PENDING_WINDOW) break;
+            continue;
+        }
+        indexEntry((uint32_t)(seq - indexBase), entry);
+    }
+    indexedUpTo = seq;
+}
+
+// Skip ids of entries that have since been dropped or purged
+static uint32_t liveIds(struct gram_postings* postings, uint32_t oldestId){
+    while (postings->start < postings->len && postings->ids[postings->start] < oldestId) postings->start++;
+    return postings->len - postings->start;
+}
+
+
+void historyIndexClear(void){
+    for (uint32_t b = 0; b < bucketCount; b++) free(table[b].ids);
+    free(table);
+    table = NULL;
+    bucketCount = usedBuckets = 0;
+    indexReady = false;
+}
+
+
+static void printMatch(uint64_t next, uint64_t seq, const char* entry){
+    printf("%5llu  %s\n", (unsigned long long)(next - seq), entry);
+}
+
+void executeLogSearch(const char* needle){
+    size_t needleLen = strlen(needle);
+    uint64_t next = historyNextSeq();
+
+    if (needleLen < 3) {
+        // Shorter than a gram: plain scan
+        for (uint64_t seq = historyOldestSeq(); seq < next; seq++) {
+            const char* entry = historyEntryBySeq(seq);
+            if (entry != NULL && strstr(entry, needle) != NULL) printMatch(next, seq, entry);
+        }
+        return;
+    }
+
+    catchUp();
+    uint32_t oldestId = (uint32_t)(historyOldestSeq() - indexBase);
+
+    // Candidates come from the needle's rarest gram; strstr confirms each one
+    struct gram_postings* rarest = NULL;
+    uint32_t rarestCount = 0;
+    for (size_t i = 0; i + 3 <= needleLen; i++) {
+        struct gram_postings* postings = findGram(gramAt(needle + i));
+        uint32_t count = (postings != NULL) ? liveIds(postings, oldestId) : 0;
+        if (count == 0) return;
+        if (rarest == NULL || count < rarestCount) {
+            rarest = postings;
+            rarestCount = count;
+        }
+    }
+    for (uint32_t i = rarest->start; i < rarest->len; i++) {
+        uint64_t seq = indexBase + rarest->ids[i];
+        const char* entry = historyEntryBySeq(seq);
+        if (entry != NULL && strstr(entry, needle) != NULL) printMatch(next, seq, entry);
+    }
+}
\ No newline at end of file
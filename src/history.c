@@ -0,0 +1,525 @@
+#include "../include/history.h"
+#include "../include/histindex.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stddef.h>
+#include <time.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+int historySyncPolicy = HISTORY_SYNC_PERIODIC;
+int historyCapacity = 0;
+
+static int storeFd = -1;
+static int usageFd = -1;
+static char* storePath = NULL;
+static struct history_header* header = NULL; // shared, read-write
+static struct history_slot* slots = NULL;    // shared; only seq is stored through the map
+static uint64_t slotCount = 0;
+
+static bool dirty = false; // appended since the last fdatasync
+static time_t lastSync = 0;
+
+static char* entryCopy = NULL; // the last entry looked up
+static size_t entryCapacity = 0;
+static uint64_t lastPushed = HISTORY_NO_SEQ;
+
+#define WRITER_WAIT_YIELDS 10000 // an older writer still filling a slot after this is taken to be dead
+
+
+static off_t slotOffset(uint64_t seq, uint64_t count){
+    return HISTORY_HEADER_SIZE + (off_t)(seq % count) * HISTORY_SLOT_SIZE;
+}
+
+static bool writeAt(int fd, const void* buf, size_t len, off_t offset){
+    while (len > 0) {
+        ssize_t written = pwrite(fd, buf, len, offset);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        buf = (const char*)buf + written;
+        len -= (size_t)written;
+        offset += written;
+    }
+    return true;
+}
+
+static off_t longAreaOffset(uint64_t count){
+    return HISTORY_HEADER_SIZE + (off_t)count * HISTORY_SLOT_SIZE;
+}
+
+static uint64_t longAreaSize(uint64_t count){
+    uint64_t size = count * HISTORY_SLOT_SIZE;
+    return size < HISTORY_LONG_MIN_SIZE ? HISTORY_LONG_MIN_SIZE : size;
+}
+
+// Bytes of text that are kept: all of it, unless even the overflow area is too small
+static size_t keptLength(size_t len, uint64_t longSize){
+    if (len <= HISTORY_TEXT_SIZE) return len;
+    uint64_t room = longSize > sizeof(struct history_long) ? longSize - sizeof(struct history_long) : 0;
+    if (room <= HISTORY_TEXT_SIZE) return HISTORY_TEXT_SIZE;
+    return len <= room ? len : (size_t)room;
+}
+
+// Where a record of need bytes goes when the stream is at head: never across the end of the ring
+static uint64_t longPlace(uint64_t head, uint64_t need, uint64_t longSize){
+    uint64_t offset = head % longSize;
+    return (offset + need > longSize) ? head + (longSize - offset) : head;
+}
+
+// Copy text into an entry buffer of len bytes, marking it if it was cut short
+static void keepText(char* out, const char* text, size_t len, size_t original){
+    memcpy(out, text, len);
+    if (len < original) memcpy(out + len - 3, "...", 3);
+}
+
+// Write the overflow record for the len kept bytes of text at stream position start
+static bool writeLong(int fd, uint64_t count, uint64_t longSize, uint64_t start,
+                      const char* text, size_t len, size_t original){
+    struct history_long record = { start, len };
+    off_t offset = longAreaOffset(count) + (off_t)(start % longSize);
+    char* copy = (char*)malloc(len);
+    if (copy == NULL) return false;
+    keepText(copy, text, len, original);
+    bool ok = writeAt(fd, &record, sizeof(record), offset)
+           && writeAt(fd, copy, len, offset + (off_t)sizeof(record));
+    free(copy);
+    return ok;
+}
+
+// Slot contents for an entry of len kept bytes: the text, or where its record starts.
+// Returns the number of bytes after seq to write.
+static size_t fillSlot(struct history_slot* slot, const char* text, size_t len, size_t original, uint64_t start){
+    slot->length = (uint32_t)len;
+    slot->reserved = 0;
+    if (len > HISTORY_TEXT_SIZE) {
+        memcpy(slot->text, &start, sizeof(start));
+        return offsetof(struct history_slot, text) - offsetof(struct history_slot, length) + sizeof(start);
+    }
+    keepText(slot->text, text, len, original);
+    return offsetof(struct history_slot, text) - offsetof(struct history_slot, length) + len;
+}
+
+static bool writeSlotBody(int fd, off_t offset, const struct history_slot* slot, size_t bodyLen){
+    return writeAt(fd, &slot->length, bodyLen, offset + (off_t)offsetof(struct history_slot, length));
+}
+
+// Fill the slot for seq in a store of count slots and commit it, in a store nobody else writes yet
+static bool writeSlot(int fd, uint64_t count, uint64_t seq, const struct history_slot* slot, size_t bodyLen){
+    off_t offset = slotOffset(seq, count);
+    uint64_t writing = 0, committed = seq + 1;
+    return writeAt(fd, &writing, sizeof(writing), offset)
+        && writeSlotBody(fd, offset, slot, bodyLen)
+        && writeAt(fd, &committed, sizeof(committed), offset);
+}
+
+// Take the mapped slot for seq (see history.h). False if a newer entry owns it.
+static bool claimSlot(uint64_t seq){
+    uint64_t* field = &slots[seq % slotCount].seq;
+    uint64_t current = __atomic_load_n(field, __ATOMIC_ACQUIRE);
+    for (int yields = 0; ; ) {
+        if ((current & ~HISTORY_SLOT_WRITING) >= seq + 1) return false;
+        if ((current & HISTORY_SLOT_WRITING) && yields < WRITER_WAIT_YIELDS) {
+            // An older entry is still being written here: let it finish first
+            yields++;
+            sched_yield();
+            current = __atomic_load_n(field, __ATOMIC_ACQUIRE);
+            continue;
+        }
+        if (__atomic_compare_exchange_n(field, &current, (seq + 1) | HISTORY_SLOT_WRITING, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            return true;
+        }
+    }
+}
+
+// Append the first len bytes of text as entry seq of the open store; its slot is claimed
+// first and committed last, its overflow record (if any) written in between
+static bool appendEntry(uint64_t seq, const char* text, size_t len){
+    if (!claimSlot(seq)) return false;
+    uint64_t longSize = __atomic_load_n(&header->longSize, __ATOMIC_ACQUIRE);
+    size_t kept = keptLength(len, longSize);
+    uint64_t start = 0;
+    bool ok = true;
+    if (kept > HISTORY_TEXT_SIZE) {
+        uint64_t need = sizeof(struct history_long) + kept;
+        uint64_t head = __atomic_load_n(&header->longHead, __ATOMIC_ACQUIRE);
+        do {
+            start = longPlace(head, need, longSize);
+        } while (!__atomic_compare_exchange_n(&header->longHead, &head, start + need, false,
+                                              __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+        ok = writeLong(storeFd, slotCount, longSize, start, text, kept, len);
+    }
+    struct history_slot slot;
+    size_t bodyLen = fillSlot(&slot, text, kept, len, start);
+    ok = ok && writeSlotBody(storeFd, slotOffset(seq, slotCount), &slot, bodyLen);
+
+    if (!ok) perror("history: write failed");
+    // On failure the slot is released empty rather than committed over a partial text
+    uint64_t writing = (seq + 1) | HISTORY_SLOT_WRITING;
+    return __atomic_compare_exchange_n(&slots[seq % slotCount].seq, &writing, ok ? seq + 1 : 0, false,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) && ok;
+}
+
+// With the file locked: give it a fresh header, count empty slots and an empty overflow area
+static bool initStore(int fd, uint64_t count){
+    uint64_t longSize = longAreaSize(count);
+    struct history_header fresh = { HISTORY_MAGIC, HISTORY_SLOT_SIZE, count, 0, 0, longSize, 0 };
+    return ftruncate(fd, 0) == 0
+        && ftruncate(fd, longAreaOffset(count) + (off_t)longSize) == 0
+        && writeAt(fd, &fresh, sizeof(fresh), 0);
+}
+
+// With the file locked: add the overflow area to a store made before it existed
+static bool addLongArea(int fd, uint64_t count){
+    uint64_t longSize = longAreaSize(count), longHead = 0;
+    return ftruncate(fd, longAreaOffset(count) + (off_t)longSize) == 0
+        && writeAt(fd, &longHead, sizeof(longHead), offsetof(struct history_header, longHead))
+        && writeAt(fd, &longSize, sizeof(longSize), offsetof(struct history_header, longSize));
+}
+
+static bool validStore(int fd, struct history_header* out){
+    struct stat st;
+    if (fstat(fd, &st) != 0 || pread(fd, out, sizeof(*out), 0) != (ssize_t)sizeof(*out)) return false;
+    return out->magic == HISTORY_MAGIC && out->slotSize == HISTORY_SLOT_SIZE
+        && out->slotCount > 0 && out->slotCount <= HISTORY_MAX_CAPACITY
+        && st.st_size >= longAreaOffset(out->slotCount) + (off_t)out->longSize;
+}
+
+static void unmapStore(void){
+    if (header != NULL) munmap(header, HISTORY_HEADER_SIZE);
+    if (slots != NULL) munmap(slots, (size_t)slotCount * HISTORY_SLOT_SIZE);
+    header = NULL;
+    slots = NULL;
+    slotCount = 0;
+    historyCapacity = 0;
+}
+
+static bool mapStore(int fd, uint64_t count){
+    void* head = mmap(NULL, HISTORY_HEADER_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    void* body = mmap(NULL, (size_t)count * HISTORY_SLOT_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, HISTORY_HEADER_SIZE);
+    if (head == MAP_FAILED || body == MAP_FAILED) {
+        if (head != MAP_FAILED) munmap(head, HISTORY_HEADER_SIZE);
+        if (body != MAP_FAILED) munmap(body, (size_t)count * HISTORY_SLOT_SIZE);
+        return false;
+    }
+    header = (struct history_header*)head;
+    slots = (struct history_slot*)body;
+    slotCount = count;
+    historyCapacity = (int)count;
+    return true;
+}
+
+// With the old store mapped and locked: write its newest entries into a new store of count
+// slots next to it, and rename that over it. Returns the new (locked) fd, or -1.
+static int rebuildStore(uint64_t count){
+    size_t tmpLen = strlen(storePath) + strlen(".tmp") + 1;
+    char* tmpPath = (char*)malloc(tmpLen);
+    if (tmpPath == NULL) return -1;
+    snprintf(tmpPath, tmpLen, "%s.tmp", storePath);
+
+    int fd = open(tmpPath, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    // Lock the replacement before it becomes visible, so no other shell writes to it first
+    bool ok = fd >= 0 && flock(fd, LOCK_EX) == 0 && initStore(fd, count);
+
+    uint64_t next = historyNextSeq();
+    uint64_t first = historyOldestSeq();
+    if (next - first > count) first = next - count;
+    uint64_t copied = 0, longSize = longAreaSize(count), longHead = 0;
+    for (uint64_t seq = first; ok && seq != next; seq++) {
+        const char* entry = historyEntryBySeq(seq);
+        if (entry == NULL) continue;
+        size_t len = strlen(entry), kept = keptLength(len, longSize);
+        uint64_t start = 0;
+        if (kept > HISTORY_TEXT_SIZE) {
+            uint64_t need = sizeof(struct history_long) + kept;
+            start = longPlace(longHead, need, longSize);
+            longHead = start + need;
+            ok = writeLong(fd, count, longSize, start, entry, kept, len);
+        }
+        struct history_slot slot;
+        size_t bodyLen = fillSlot(&slot, entry, kept, len, start);
+        ok = ok && writeSlot(fd, count, copied, &slot, bodyLen);
+        copied++;
+    }
+    ok = ok && writeAt(fd, &copied, sizeof(copied), offsetof(struct history_header, head))
+            && writeAt(fd, &longHead, sizeof(longHead), offsetof(struct history_header, longHead))
+            && rename(tmpPath, storePath) == 0;
+
+    if (!ok && fd >= 0) {
+        close(fd);
+        unlink(tmpPath);
+        fd = -1;
+    }
+    free(tmpPath);
+    return fd;
+}
+
+// Old text history (one command per line), oldest first
+static void importLegacy(const char* dir){
+    size_t pathLen = strlen(dir) + strlen("/" HISTORY_LEGACY_FILE_NAME) + 1;
+    char* path = (char*)malloc(pathLen);
+    if (path == NULL) return;
+    snprintf(path, pathLen, "%s/%s", dir, HISTORY_LEGACY_FILE_NAME);
+    FILE* file = fopen(path, "r");
+    free(path);
+    if (file == NULL) return;
+
+    char* line = NULL;
+    size_t capacity = 0;
+    ssize_t read;
+    while ((read = getline(&line, &capacity, file)) >= 0) {
+        size_t len = strcspn(line, "\n");
+        if (len > 0) historyPush(line, len);
+    }
+    free(line);
+    fclose(file);
+}
+
+// Open and map path; if the file is new or unusable, or resize is set, (re)build it at capacity slots
+static bool openStore(const char* path, uint64_t capacity, bool resize, bool* created){
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    while (flock(fd, LOCK_EX) != 0 && errno == EINTR);
+
+    struct history_header current;
+    *created = !validStore(fd, &current);
+    if (*created) {
+        if (!initStore(fd, capacity)) {
+            close(fd);
+            return false;
+        }
+        current.slotCount = capacity;
+    } else if (current.longSize == 0 && !addLongArea(fd, current.slotCount)) {
+        close(fd);
+        return false;
+    }
+    if (!mapStore(fd, current.slotCount)) {
+        close(fd);
+        return false;
+    }
+    storeFd = fd;
+
+    if (resize && !*created && current.slotCount != capacity) {
+        int newFd = rebuildStore(capacity);
+        if (newFd >= 0) {
+            unmapStore();
+            close(storeFd);
+            storeFd = newFd;
+            if (!mapStore(newFd, capacity)) {
+                close(newFd);
+                storeFd = -1;
+                return false;
+            }
+        }
+    }
+    flock(storeFd, LOCK_UN);
+    return true;
+}
+
+
+bool historyOpen(const char* dir, int capacity, bool resize){
+    size_t pathLen = strlen(dir) + strlen("/" HISTORY_FILE_NAME) + 1;
+    storePath = (char*)malloc(pathLen);
+    if (storePath == NULL) return false;
+    snprintf(storePath, pathLen, "%s/%s", dir, HISTORY_FILE_NAME);
+
+    bool created = false;
+    if (openStore(storePath, (uint64_t)capacity, resize, &created)) {
+        if (created) importLegacy(dir);
+        // Usage records are optional: without the file they are just not kept
+        size_t usageLen = strlen(dir) + strlen("/" HISTORY_USAGE_FILE_NAME) + 1;
+        char* usagePath = (char*)malloc(usageLen);
+        if (usagePath != NULL) {
+            snprintf(usagePath, usageLen, "%s/%s", dir, HISTORY_USAGE_FILE_NAME);
+            usageFd = open(usagePath, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+            free(usagePath);
+        }
+        return true;
+    }
+
+    // Home directory not writable: keep a private store for this session
+    perror("history: cannot open history store");
+    char privatePath[] = "/tmp/shell-history-XXXXXX";
+    int fd = mkstemp(privatePath);
+    if (fd < 0) return false;
+    close(fd);
+    free(storePath);
+    storePath = strdup(privatePath);
+    bool opened = openStore(storePath, (uint64_t)capacity, false, &created);
+    unlink(privatePath);
+    return opened;
+}
+
+void historyRefresh(void){
+    struct stat st;
+    if (storeFd < 0 || fstat(storeFd, &st) != 0 || st.st_nlink > 0) return;
+
+    // Rebuilt by another shell: move to the file now at storePath
+    uint64_t capacity = slotCount;
+    historySync(true);
+    unmapStore();
+    close(storeFd);
+    storeFd = -1;
+    historyIndexClear();
+    bool created = false;
+    if (!openStore(storePath, capacity, false, &created)) perror("history: cannot reopen history store");
+}
+
+// Shared lock on the current store, so that no rebuild runs while entries are added to it
+static bool lockForAppend(void){
+    struct stat st;
+    while (storeFd >= 0) {
+        while (flock(storeFd, LOCK_SH) != 0) {
+            if (errno != EINTR) return false;
+        }
+        if (fstat(storeFd, &st) == 0 && st.st_nlink > 0) return true;
+        // Rebuilt while this shell waited for the lock: append to the new file instead
+        flock(storeFd, LOCK_UN);
+        historyRefresh();
+    }
+    return false;
+}
+
+void historyPush(const char* commandString, size_t len){
+    lastPushed = HISTORY_NO_SEQ;
+    historyRefresh();
+    if (header == NULL || !lockForAppend()) return;
+
+    uint64_t seq = __atomic_load_n(&header->head, __ATOMIC_ACQUIRE);
+    while (!__atomic_compare_exchange_n(&header->head, &seq, seq + 1, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+    // A newer entry may already have taken the slot over: then this one is gone anyway
+    if (appendEntry(seq, commandString, len)) lastPushed = seq;
+    flock(storeFd, LOCK_UN);
+    dirty = true;
+    historySync(false);
+}
+
+uint64_t historyLastPushed(void){
+    return lastPushed;
+}
+
+
+static uint32_t textHash(const char* text){
+    uint32_t hash = 2166136261u;
+    for (; *text; text++) hash = (hash ^ (unsigned char)*text) * 16777619u;
+    return hash;
+}
+
+void historySetUsage(uint64_t seq, const struct history_usage* usage){
+    const char* entry = historyEntryBySeq(seq);
+    if (usageFd < 0 || entry == NULL) return;
+    struct history_usage record = *usage;
+    record.textHash = textHash(entry);
+    off_t offset = (off_t)(seq % slotCount) * (off_t)sizeof(record);
+    uint64_t writing = 0;
+    record.seq = seq + 1;
+    const size_t bodyStart = offsetof(struct history_usage, textHash);
+    if (!writeAt(usageFd, &writing, sizeof(writing), offset)
+        || !writeAt(usageFd, (const char*)&record + bodyStart, sizeof(record) - bodyStart, offset + (off_t)bodyStart)
+        || !writeAt(usageFd, &record.seq, sizeof(record.seq), offset)) {
+        perror("history: usage write failed");
+    }
+}
+
+bool historyUsageBySeq(uint64_t seq, struct history_usage* out){
+    const char* entry = historyEntryBySeq(seq);
+    if (usageFd < 0 || entry == NULL) return false;
+    off_t offset = (off_t)(seq % slotCount) * (off_t)sizeof(*out);
+    if (pread(usageFd, out, sizeof(*out), offset) != (ssize_t)sizeof(*out)) return false;
+    return out->seq == seq + 1 && out->textHash == textHash(entry);
+}
+
+uint64_t historyNextSeq(void){
+    return header ? __atomic_load_n(&header->head, __ATOMIC_ACQUIRE) : 0;
+}
+
+uint64_t historyOldestSeq(void){
+    if (header == NULL) return 0;
+    uint64_t next = historyNextSeq();
+    uint64_t purged = __atomic_load_n(&header->purged, __ATOMIC_ACQUIRE);
+    uint64_t oldest = next > slotCount ? next - slotCount : 0;
+    return purged > oldest ? purged : oldest;
+}
+
+int historyCount(void){
+    return (int)(historyNextSeq() - historyOldestSeq());
+}
+
+const char* historyEntryBySeq(uint64_t seq){
+    if (header == NULL || seq < historyOldestSeq() || seq >= historyNextSeq()) return NULL;
+
+    const struct history_slot* slot = &slots[seq % slotCount];
+    if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != seq + 1) return NULL;
+    uint32_t length = slot->length;
+    if ((size_t)length + 1 > entryCapacity) {
+        size_t capacity = entryCapacity ? entryCapacity : HISTORY_TEXT_SIZE + 1;
+        while ((size_t)length + 1 > capacity) capacity *= 2;
+        char* grown = (char*)realloc(entryCopy, capacity);
+        if (grown == NULL) return NULL;
+        entryCopy = grown;
+        entryCapacity = capacity;
+    }
+    if (length <= HISTORY_TEXT_SIZE) {
+        memcpy(entryCopy, slot->text, length);
+    } else {
+        // In the overflow area: valid while nothing has been claimed over it since
+        uint64_t start, longSize = __atomic_load_n(&header->longSize, __ATOMIC_ACQUIRE);
+        memcpy(&start, slot->text, sizeof(start));
+        if (longSize == 0) return NULL;
+        struct history_long record;
+        off_t offset = longAreaOffset(slotCount) + (off_t)(start % longSize);
+        if (pread(storeFd, &record, sizeof(record), offset) != (ssize_t)sizeof(record)
+            || record.start != start || record.length != length
+            || pread(storeFd, entryCopy, length, offset + (off_t)sizeof(record)) != (ssize_t)length) {
+            return NULL;
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&header->longHead, __ATOMIC_ACQUIRE) > start + longSize) return NULL;
+    }
+    entryCopy[length] = '\0';
+    // Another shell may have reclaimed the slot while it was being copied
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != seq + 1) return NULL;
+    return entryCopy;
+}
+
+const char* historyEntry(int index){
+    if (index < 1 || index > historyCount()) return NULL;
+    return historyEntryBySeq(historyNextSeq() - (uint64_t)index);
+}
+
+void historyClear(void){
+    if (header == NULL) return;
+    uint64_t next = historyNextSeq();
+    uint64_t purged = __atomic_load_n(&header->purged, __ATOMIC_ACQUIRE);
+    while (purged < next && !__atomic_compare_exchange_n(&header->purged, &purged, next, false,
+                                                         __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+    historyIndexClear();
+    dirty = true;
+    historySync(false);
+}
+
+void historySync(bool force){
+    if (!dirty || storeFd < 0) return;
+    if (historySyncPolicy == HISTORY_SYNC_NEVER && !force) return;
+    time_t now = time(NULL);
+    if (!force && historySyncPolicy == HISTORY_SYNC_PERIODIC && now - lastSync < HISTORY_FSYNC_SECONDS) return;
+    fdatasync(storeFd);
+    lastSync = now;
+    dirty = false;
+}
+
+void historyClose(void){
+    if (usageFd >= 0) close(usageFd);
+    usageFd = -1;
+    if (storeFd < 0) return;
+    if (historySyncPolicy != HISTORY_SYNC_NEVER) historySync(true);
+    unmapStore();
+    close(storeFd);
+    storeFd = -1;
+}
\ No newline at end of file
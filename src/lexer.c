@@ -0,0 +1,284 @@
+#include "../include/lexer.h"
+
+const unsigned char lexCharClass[256] = {
+    [' '] = CC_SPACE, ['\t'] = CC_SPACE, ['\n'] = CC_SPACE,
+    ['\v'] = CC_SPACE, ['\f'] = CC_SPACE, ['\r'] = CC_SPACE,
+    [';'] = CC_GROUP, ['&'] = CC_GROUP,
+    ['|'] = CC_PIPE,
+    ['<'] = CC_REDIR, ['>'] = CC_REDIR,
+};
+
+// Everything the lexer needs to remember while walking the input once.
+// At most one cmd_group, atomic, terminal and token are open at any time.
+struct lexState {
+    char* input;     // caller's line, only ever read
+    char* source;    // owned copy; cmd_group separators become '\0'
+    char* argBuffer; // owned copy; every token is '\0'-terminated in place
+    struct arena* arena;
+    bool valid;
+    bool failed; // allocation failure somewhere during the scan
+
+    struct shell_cmd* shell;
+    int groupCap;
+
+    struct cmd_group* group;
+    int groupStart;
+    int atomicCap;
+
+    struct atomic* atomic;
+    int atomicStart;
+    int terminalCap;
+
+    struct terminal* terminal;
+    int terminalStart;
+    int argCap;
+
+    int tokenStart; // -1 when not inside a cmd/arg token
+};
+
+
+// Make room for one more entry in a growable arena array (capacity doubles)
+static void* growArray(struct arena* arena, void* arr, int count, int* capacity, size_t elemSize){
+    if (arr != NULL && count < *capacity) return arr;
+    int oldCapacity = (arr != NULL) ? *capacity : 0;
+    int newCapacity = (*capacity > 0) ? *capacity : 4;
+    while (newCapacity <= count) newCapacity *= 2;
+    void* grown = arenaRealloc(arena, arr, oldCapacity * elemSize, newCapacity * elemSize);
+    if (grown == NULL) return NULL;
+    *capacity = newCapacity;
+    return grown;
+}
+
+
+// Separators are shared literals, nothing to allocate or free per command
+static char* separatorString(const char* input, int start, int length){
+    if (length == 0) return "";
+    switch (input[start]) {
+        case ';': return ";";
+        case '&': return (length == 3) ? "&&&" : "&";
+        case '|': return "|";
+        case '<': return "<";
+        default:  return (length == 2) ? ">>" : ">";
+    }
+}
+
+
+static void openGroup(struct lexState* st, int start){
+    struct shell_cmd* shell = st->shell;
+    int cap = st->groupCap;
+    struct cmd_group** groups = growArray(st->arena, shell->cmdGroupArr, shell->cmdArrIndex, &cap, sizeof(struct cmd_group*));
+    if (groups == NULL) { st->failed = true; return; }
+    shell->cmdGroupArr = groups;
+    cap = st->groupCap;
+    char** seps = growArray(st->arena, shell->separatorArr, shell->cmdArrIndex, &cap, sizeof(char*));
+    if (seps == NULL) { st->failed = true; return; }
+    shell->separatorArr = seps;
+    st->groupCap = cap;
+
+    struct cmd_group* group = (struct cmd_group*)arenaCalloc(st->arena, sizeof(struct cmd_group));
+    if (group == NULL) { st->failed = true; return; }
+    shell->cmdGroupArr[shell->cmdArrIndex++] = group;
+    st->group = group;
+    st->groupStart = start;
+    st->atomicCap = 0;
+}
+
+static void openAtomic(struct lexState* st, int start){
+    struct cmd_group* group = st->group;
+    int cap = st->atomicCap;
+    struct atomic** atomics = growArray(st->arena, group->atomicArr, group->atomicArrIndex, &cap, sizeof(struct atomic*));
+    if (atomics == NULL) { st->failed = true; return; }
+    group->atomicArr = atomics;
+    cap = st->atomicCap;
+    char** seps = growArray(st->arena, group->separatorArr, group->atomicArrIndex, &cap, sizeof(char*));
+    if (seps == NULL) { st->failed = true; return; }
+    group->separatorArr = seps;
+    st->atomicCap = cap;
+
+    struct atomic* atomic = (struct atomic*)arenaCalloc(st->arena, sizeof(struct atomic));
+    if (atomic == NULL) { st->failed = true; return; }
+    group->atomicArr[group->atomicArrIndex++] = atomic;
+    st->atomic = atomic;
+    st->atomicStart = start;
+    st->terminalCap = 0;
+}
+
+static void openTerminal(struct lexState* st, int start){
+    struct atomic* atomic = st->atomic;
+    int cap = st->terminalCap;
+    struct terminal** terminals = growArray(st->arena, atomic->terminalArr, atomic->termArrIndex, &cap, sizeof(struct terminal*));
+    if (terminals == NULL) { st->failed = true; return; }
+    atomic->terminalArr = terminals;
+    cap = st->terminalCap;
+    char** seps = growArray(st->arena, atomic->separatorArr, atomic->termArrIndex, &cap, sizeof(char*));
+    if (seps == NULL) { st->failed = true; return; }
+    atomic->separatorArr = seps;
+    st->terminalCap = cap;
+
+    struct terminal* terminal = (struct terminal*)arenaCalloc(st->arena, sizeof(struct terminal));
+    if (terminal == NULL) { st->failed = true; return; }
+    atomic->terminalArr[atomic->termArrIndex++] = terminal;
+    st->terminal = terminal;
+    st->terminalStart = start;
+
+    // cmdAndArgs is always a NULL-terminated array, even with no tokens
+    st->argCap = 0;
+    terminal->cmdAndArgs = growArray(st->arena, NULL, 1, &st->argCap, sizeof(char*));
+    if (terminal->cmdAndArgs == NULL) { st->failed = true; return; }
+    terminal->cmdAndArgs[0] = NULL;
+}
+
+static void endToken(struct lexState* st, int end){
+    if (st->tokenStart < 0) return;
+    struct terminal* terminal = st->terminal;
+    // keep one spare slot for the NULL terminator
+    char** args = growArray(st->arena, terminal->cmdAndArgs, terminal->cmdAndArgsIndex + 1, &st->argCap, sizeof(char*));
+    if (args == NULL) { st->failed = true; return; }
+    terminal->cmdAndArgs = args;
+    // The byte after a token is whitespace, an operator or the end, so it can become '\0'
+    st->argBuffer[end] = '\0';
+    args[terminal->cmdAndArgsIndex++] = st->argBuffer + st->tokenStart;
+    args[terminal->cmdAndArgsIndex] = NULL;
+    st->tokenStart = -1;
+}
+
+// Close the open terminal at 'end'; its separator is input[end, end+sepLen)
+static void closeTerminal(struct lexState* st, int end, int sepLen){
+    struct atomic* atomic = st->atomic;
+    st->terminal->terminalString = st->source + st->terminalStart;
+    st->terminal->terminalLength = end - st->terminalStart;
+    char* sep = separatorString(st->input, end, sepLen);
+    atomic->separatorArr[atomic->sepArrIndex++] = sep;
+    st->terminal = NULL;
+}
+
+static void closeAtomic(struct lexState* st, int end, int sepLen){
+    struct cmd_group* group = st->group;
+    st->atomic->atomicString = st->source + st->atomicStart;
+    st->atomic->atomicLength = end - st->atomicStart;
+    char* sep = separatorString(st->input, end, sepLen);
+    group->separatorArr[group->sepArrIndex++] = sep;
+    // "| ls" or "ls | | wc" produce an empty atomic
+    if (end == st->atomicStart) st->valid = false;
+    st->atomic = NULL;
+}
+
+static void closeGroup(struct lexState* st, int end, int sepLen){
+    struct shell_cmd* shell = st->shell;
+    struct cmd_group* group = st->group;
+    // cmd_groups never overlap, so cmdString can be terminated in place
+    st->source[end] = '\0';
+    group->cmdString = st->source + st->groupStart;
+    group->cmdLength = end - st->groupStart;
+    char* sep = separatorString(st->input, end, sepLen);
+    shell->separatorArr[shell->sepArrIndex++] = sep;
+
+    // Empty group (";;", "& ls") or a pipe with nothing after it ("ls |")
+    if (group->atomicArrIndex == 0) st->valid = false;
+    else if (group->separatorArr[group->sepArrIndex - 1][0] == '|') st->valid = false;
+    st->group = NULL;
+}
+
+// Copy the final verdict onto every node so the executor's per-level checks agree
+static void markValidity(struct shell_cmd* shell, bool valid){
+    shell->validity = valid;
+    for (int i = 0; i < shell->cmdArrIndex; i++) {
+        struct cmd_group* group = shell->cmdGroupArr[i];
+        group->validity = valid;
+        for (int j = 0; j < group->atomicArrIndex; j++) {
+            struct atomic* atomic = group->atomicArr[j];
+            atomic->validity = valid;
+            for (int k = 0; k < atomic->termArrIndex; k++) {
+                atomic->terminalArr[k]->validity = valid;
+            }
+        }
+    }
+}
+
+
+struct shell_cmd* lexShellCommand(char* input, struct arena* arena){
+    struct shell_cmd* shell = (struct shell_cmd*)arenaCalloc(arena, sizeof(struct shell_cmd));
+    if (shell == NULL) return NULL;
+    shell->arena = arena;
+
+    struct lexState st = {0};
+    st.input = input;
+    st.arena = arena;
+    st.valid = true;
+    st.shell = shell;
+    st.tokenStart = -1;
+
+    // The only copies of the line: one keeps the text, the other is sliced into argv
+    int length = strlen(input);
+    st.source = arenaStrndup(arena, input, length);
+    st.argBuffer = arenaStrndup(arena, input, length);
+    if (st.source == NULL || st.argBuffer == NULL) return NULL;
+    shell->source = st.source;
+    shell->argBuffer = st.argBuffer;
+    shell->lineLength = length;
+
+    // The terminating '\0' is handled like a separator that closes everything still open
+    for (int i = 0; i <= length && !st.failed; i++) {
+        unsigned char cls = (i < length) ? lexCharClass[(unsigned char)input[i]] : CC_GROUP;
+        int sepLen = (i < length) ? 1 : 0;
+
+        if (cls & CC_SPACE) {
+            endToken(&st, i);
+            continue;
+        }
+
+        if (cls & CC_GROUP) {
+            // "&&&" joins cmd_groups into one parallel batch
+            if (input[i] == '&' && input[i + 1] == '&' && input[i + 2] == '&') sepLen = 3;
+            endToken(&st, i);
+            if (st.terminal) closeTerminal(&st, i, 0);
+            if (st.atomic) closeAtomic(&st, i, 0);
+            if (st.group == NULL) {
+                if (i == length) break;
+                openGroup(&st, i); // separator with nothing before it
+                if (st.failed) break;
+            }
+            closeGroup(&st, i, sepLen);
+            i += (sepLen > 1) ? sepLen - 1 : 0;
+            continue;
+        }
+
+        if (st.group == NULL) openGroup(&st, i);
+        if (st.failed) break;
+
+        if (cls & CC_PIPE) {
+            endToken(&st, i);
+            if (st.terminal) closeTerminal(&st, i, 0);
+            if (st.atomic == NULL) openAtomic(&st, i);
+            if (st.failed) break;
+            closeAtomic(&st, i, 1);
+            continue;
+        }
+
+        if (st.atomic == NULL) openAtomic(&st, i);
+        if (!st.failed && st.terminal == NULL) openTerminal(&st, i);
+        if (st.failed) break;
+
+        if (cls & CC_REDIR) {
+            endToken(&st, i);
+            int redirLen = (input[i] == '>' && input[i + 1] == '>') ? 2 : 1;
+            closeTerminal(&st, i, redirLen);
+            i += redirLen - 1;
+            continue;
+        }
+
+        if (st.tokenStart < 0) st.tokenStart = i;
+    }
+
+    // Partially built nodes are released with the arena
+    if (st.failed) return NULL;
+
+    // Last separator should be empty or ampersand (if present)
+    if (shell->sepArrIndex > 0) {
+        const char* last = shell->separatorArr[shell->sepArrIndex - 1];
+        if (last[0] == ';' || strcmp(last, "&&&") == 0) st.valid = false;
+    }
+
+    markValidity(shell, st.valid);
+    return shell;
+}
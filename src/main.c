@@ -9,16 +9,42 @@
  #include <signal.h>
  #include <termios.h>
  #include <errno.h>
+ #include <fcntl.h>
 
 #include "../include/printPrompt.h"
 #include "../include/parser.h"
 #include "../include/partB.h"
 #include "../include/executes.h"
 #include "../include/partE.h"
-
-
-
-int main(){
+#include "../include/parsecache.h"
+#include "../include/runner.h"
+
+
+// EOF (Ctrl-D or end of script): kill all children, print logout and exit 0
+static void logout(void){
+    // Send SIGKILL to all child processes/process groups
+    kill_all_children();
+    closeLogs(); // Write out and sync any queued history
+    printf("logout\n");
+    fflush(stdout);
+    exit(0);
+}
+
+int main(int argc, char* argv[]){
+
+    // Batch mode: "-s script", or stdin that is not a terminal
+    int scriptFd = -1;
+    if (argc == 3 && strcmp(argv[1], "-s") == 0) {
+        scriptFd = open(argv[2], O_RDONLY | O_CLOEXEC);
+        if (scriptFd < 0) {
+            perror(argv[2]);
+            exit(1);
+        }
+    } else if (argc != 1) {
+        fprintf(stderr, "Usage: %s [-s script]\n", argv[0]);
+        exit(1);
+    }
+    bool batch = scriptFd >= 0 || !isatty(STDIN_FILENO);
 
     mainPid = getpid();
     // Put the shell in its own process group and grab the controlling terminal
@@ -32,14 +58,27 @@ int main(){
     signal(SIGTSTP, SIG_IGN);
     signal(SIGTTIN, SIG_IGN);
     signal(SIGTTOU, SIG_IGN);
+    // Child statuses arrive through a signalfd (see reaper.h)
+    reaperInit();
 
     // Store the directory path in which the shell is started in 
-    absoluteHomePath = getcwd(NULL, 0);
-    if (absoluteHomePath == NULL){
+    // (the only getcwd: hop keeps currentWD up to date from here on, see cwd.h)
+    if (!cwdInit() || (absoluteHomePath = strdup(currentWD)) == NULL){
         perror("getcwd() error");
         exit(1);
     };
 
+    // The zygote is forked now, while the shell is still small (see zygote.h)
+    const char* zygote = getenv("SHELL_ZYGOTE");
+    if (zygote != NULL && strcmp(zygote, "0") != 0 && zygoteStart()) launchBackend = LAUNCH_ZYGOTE;
+
+    loadLogs(); // Click to enter
+
+    if (batch) {
+        runBatch(scriptFd >= 0 ? scriptFd : STDIN_FILENO);
+        logout();
+    }
+
     char* username = getlogin();
     if (username == NULL){
         perror("getlogin() error");
@@ -50,31 +89,29 @@ int main(){
     struct utsname* sysinfo = (struct utsname*)malloc(sizeof(struct utsname));
     uname(sysinfo);
 
-    loadLogs(); // Click to enter
-
     while(1){
+        // Everything from here to the prompt being shown is overhead (see stats.h)
+        statsBegin(STATS_PROMPT);
         // Check for completed background jobs and print exit messages for them
         check_bg_jobs();
 
+        // Write the last command's history entry before sitting at the prompt
+        saveLog();
+
         // Ready to accept commands:
-        // Collect current working directory and username:
-        char *currentPath = NULL;
-        currentPath = getcwd(NULL, 0);
-        if (currentPath== NULL){
-            perror("getcwd() error");
-            exit(1);
-        };
-        
-        char* pathToPrint = getPathToPrint(absoluteHomePath, currentPath);
-        
-        // Only print the prompt when running interactively (stdin is a terminal).
-        if (isatty(STDIN_FILENO)){
-            printf("<%s@%s:%s> ",username, sysinfo->nodename, pathToPrint);
-            fflush(stdout); // Ensure the prompt is displayed immediately
+        // Prompt for the current working directory and username (rebuilt only after a hop)
+        const char* prompt = getPrompt(username, sysinfo->nodename, absoluteHomePath);
+        fputs(prompt, stdout);
+        fflush(stdout); // Ensure the prompt is displayed immediately
+        statsEnd(STATS_PROMPT);
+
+        // Report background jobs that end while we sit at the prompt right away
+        while (!waitForInput(STDIN_FILENO)) {
+            printf("\n");
+            check_bg_jobs();
+            fputs(prompt, stdout);
+            fflush(stdout);
         }
-        
-        free(pathToPrint); // Free memory
-        free(currentPath);
 
 
         // Take user command:
@@ -82,13 +119,8 @@ int main(){
         if (fgets(input, MAX_INPUT_SIZE, stdin) == NULL) {
             // Handle EOF (Ctrl-D)
             if (feof(stdin)) {
-                if (isatty(STDIN_FILENO)) printf("\n");
-                // Send SIGKILL to all child processes/process groups
-                kill_all_children();
-                // Print logout and exit 0
-                printf("logout\n");
-                fflush(stdout);
-                exit(0);
+                printf("\n");
+                logout();
             }
             // Handle interrupted read
             if (ferror(stdin)) {
@@ -104,26 +136,8 @@ int main(){
         input[strcspn(input, "\n")] = '\0'; // Remove trailing newline char
         if (strlen(input) == 0) continue; // Skip empty input
 
+        runInputLine(input);
 
-        // Verify user command:
-        //printf("INPUT SCANNED: %s\n",input);
-        struct shell_cmd* shellCmdStruct = verifyCommand(input);
-        if (shellCmdStruct->validity == false){
-            freeShellCmd(shellCmdStruct);
-            continue;
-        }
-        
-        // Add to log if not duplicate of last executed command and not log command
-        if ((listTail == NULL || strcmp(input, listTail->shellCommandString) != 0) && strstr(input, "log") == NULL) {
-            addLog(input);
-        }
-        
-        // Process user command
-        executeShellCommand(shellCmdStruct);
-
-        // Free memory allocations at each level
-        freeShellCmd(shellCmdStruct);
-        
         // Repeat
     }
     return 0;
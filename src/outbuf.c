@@ -0,0 +1,82 @@
+#include "../include/outbuf.h"
+#include <errno.h>
+
+
+bool outInitMemory(struct out_buffer* out){
+    out->fd = -1;
+    out->len = 0;
+    out->size = OUTBUF_SIZE;
+    out->failed = false;
+    out->buf = (char*)malloc(out->size);
+    if (out->buf == NULL) {
+        perror("malloc failed");
+        return false;
+    }
+    return true;
+}
+
+bool outInit(struct out_buffer* out, int fd){
+    fflush(stdout);
+    if (!outInitMemory(out)) return false;
+    out->fd = fd;
+    return true;
+}
+
+// In-memory buffers: make room for len more bytes
+static void grow(struct out_buffer* out, size_t len){
+    size_t newSize = out->size;
+    while (out->len + len > newSize) newSize *= 2;
+    char* grown = (char*)realloc(out->buf, newSize);
+    if (grown == NULL) {
+        perror("realloc failed");
+        out->failed = true;
+        return;
+    }
+    out->buf = grown;
+    out->size = newSize;
+}
+
+static void sendAll(struct out_buffer* out, const char* data, size_t len){
+    while (len > 0 && !out->failed) {
+        ssize_t written = write(out->fd, data, len);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            out->failed = true; // EPIPE and friends: stop producing output
+            break;
+        }
+        data += written;
+        len -= (size_t)written;
+    }
+}
+
+void outFlush(struct out_buffer* out){
+    if (out->fd < 0) return;
+    sendAll(out, out->buf, out->len);
+    out->len = 0;
+}
+
+void outWrite(struct out_buffer* out, const char* data, size_t len){
+    if (out->failed) return;
+    if (out->len + len > out->size && out->fd < 0) {
+        grow(out, len);
+        if (out->failed) return;
+    } else if (out->len + len > out->size) {
+        outFlush(out);
+        if (len > out->size) {
+            sendAll(out, data, len); // too big to be worth buffering
+            return;
+        }
+    }
+    memcpy(out->buf + out->len, data, len);
+    out->len += len;
+}
+
+void outString(struct out_buffer* out, const char* s){
+    outWrite(out, s, strlen(s));
+}
+
+void outFree(struct out_buffer* out){
+    outFlush(out);
+    free(out->buf);
+    out->buf = NULL;
+}
\ No newline at end of file
@@ -0,0 +1,249 @@
+#include "../include/parallel.h"
+#include "../include/executes.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+static char chunk[PARALLEL_READ_SIZE];
+
+
+static int poolSize(void){
+    const char* value = getenv("PARALLEL_JOBS");
+    long jobs = (value != NULL) ? strtol(value, NULL, 10) : sysconf(_SC_NPROCESSORS_ONLN);
+    if (jobs < 1) jobs = 1;
+    if (jobs > PARALLEL_MAX_JOBS) jobs = PARALLEL_MAX_JOBS;
+    return (int)jobs;
+}
+
+static void writeAll(int fd, const char* data, size_t len){
+    while (len > 0) {
+        ssize_t written = write(fd, data, len);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return; // EPIPE and friends: the output is dropped, the jobs still run
+        }
+        data += written;
+        len -= (size_t)written;
+    }
+}
+
+static void defaultSignals(void){
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTSTP, SIG_DFL);
+    signal(SIGTTIN, SIG_DFL);
+    signal(SIGTTOU, SIG_DFL);
+}
+
+static void stdinFromDevNull(void){
+    int devnull = open("/dev/null", O_RDONLY);
+    if (devnull >= 0) {
+        dup2(devnull, STDIN_FILENO);
+        close(devnull);
+    }
+}
+
+// In the leader: fork one job into the leader's process group, its output into two pipes
+static bool startJob(struct parallel_job* job, pid_t leader){
+    job->started = true;
+    int pipes[2][2];
+    if (pipe(pipes[0]) != 0) {
+        perror("pipe failed");
+    } else if (pipe(pipes[1]) != 0) {
+        perror("pipe failed");
+        close(pipes[0][0]);
+        close(pipes[0][1]);
+    } else {
+        for (int k = 0; k < 2; k++) fcntl(pipes[k][0], F_SETFD, FD_CLOEXEC); // later jobs must not hold them
+        fflush(stdout);
+        job->pid = fork();
+        if (job->pid == 0) {
+            setpgid(0, leader);
+            // Run the group exactly like a background job leader would
+            bg_fork = 1;
+            current_job_pgid = leader;
+            stdinFromDevNull();
+            dup2(pipes[0][1], STDOUT_FILENO);
+            dup2(pipes[1][1], STDERR_FILENO);
+            for (int k = 0; k < 2; k++) {
+                close(pipes[k][0]);
+                close(pipes[k][1]);
+            }
+            executeCmdGroup(job->group);
+            fflush(stdout);
+            exit(lastExitStatus);
+        }
+        for (int k = 0; k < 2; k++) {
+            close(pipes[k][1]);
+            job->fds[k] = pipes[k][0];
+        }
+        if (job->pid > 0) return true;
+        perror("fork failed");
+        for (int k = 0; k < 2; k++) {
+            close(job->fds[k]);
+            job->fds[k] = -1;
+        }
+    }
+    job->waited = true;
+    job->status = 127;
+    return false;
+}
+
+// A job reached the head of the queue: out with what it produced so far
+static void releaseHeld(struct parallel_job* job){
+    for (int k = 0; k < 2; k++) {
+        if (job->out[k].buf == NULL) continue;
+        writeAll(k == 0 ? STDOUT_FILENO : STDERR_FILENO, job->out[k].buf, job->out[k].len);
+        free(job->out[k].buf);
+        job->out[k].buf = NULL;
+    }
+}
+
+static void readJob(struct parallel_job* job, int k, bool head){
+    ssize_t got = read(job->fds[k], chunk, sizeof(chunk));
+    if (got < 0 && (errno == EINTR || errno == EAGAIN)) return;
+    if (got <= 0) {
+        close(job->fds[k]);
+        job->fds[k] = -1;
+        return;
+    }
+    if (head) {
+        writeAll(k == 0 ? STDOUT_FILENO : STDERR_FILENO, chunk, (size_t)got);
+        return;
+    }
+    if (job->out[k].buf == NULL && !outInitMemory(&job->out[k])) return;
+    outWrite(&job->out[k], chunk, (size_t)got);
+}
+
+// The leader's loop; returns the number of jobs that failed
+static int runJobs(struct parallel_job* jobs, int count){
+    int limit = poolSize();
+    pid_t leader = getpid();
+    int next = 0, head = 0, running = 0, failed = 0;
+    struct pollfd fds[2 * PARALLEL_MAX_JOBS];
+    int owners[2 * PARALLEL_MAX_JOBS];
+
+    while (head < count) {
+        while (running < limit && next < count) {
+            if (startJob(&jobs[next], leader)) running++;
+            next++;
+        }
+
+        // Only running jobs hold pipes, so at most 2 * limit of them
+        int polled = 0;
+        for (int i = head; i < next; i++) {
+            for (int k = 0; k < 2; k++) {
+                if (jobs[i].fds[k] < 0) continue;
+                fds[polled].fd = jobs[i].fds[k];
+                fds[polled].events = POLLIN;
+                owners[polled++] = 2 * i + k;
+            }
+        }
+        if (polled > 0 && poll(fds, (nfds_t)polled, -1) < 0) {
+            if (errno == EINTR) continue;
+            perror("poll failed");
+            break;
+        }
+        for (int p = 0; p < polled; p++) {
+            if (fds[p].revents == 0) continue;
+            int i = owners[p] / 2;
+            readJob(&jobs[i], owners[p] % 2, i == head);
+        }
+
+        // Both pipes at EOF: the job is exiting
+        for (int i = head; i < next; i++) {
+            struct parallel_job* job = &jobs[i];
+            if (job->waited || job->fds[0] >= 0 || job->fds[1] >= 0) continue;
+            int status = 0;
+            while (waitpid(job->pid, &status, 0) < 0 && errno == EINTR);
+            job->status = exitStatusOf(status);
+            job->waited = true;
+            running--;
+        }
+
+        while (head < count && jobs[head].waited) {
+            if (jobs[head].status != 0) failed++;
+            head++;
+            if (head < count) releaseHeld(&jobs[head]);
+        }
+    }
+    return failed;
+}
+
+// "a &&& b &&& c" for the job tables
+static char* batchName(const struct plan_node** groups, int count){
+    size_t length = 1;
+    for (int i = 0; i < count; i++) length += strlen(groups[i]->text) + strlen(" &&& ");
+    char* name = (char*)malloc(length);
+    if (name == NULL) return NULL;
+    name[0] = '\0';
+    for (int i = 0; i < count; i++) {
+        if (i > 0) strcat(name, " &&& ");
+        strcat(name, groups[i]->text);
+    }
+    return name;
+}
+
+
+void executeParallel(const struct plan_node** groups, int count, bool background){
+    fflush(stdout);
+    pid_t leader = fork();
+    if (leader < 0) {
+        perror("Fork failed");
+        return;
+    }
+    if (leader == 0) {
+        reaperChildInit();
+        setpgid(0, 0);
+        defaultSignals();
+        if (background) stdinFromDevNull();
+        struct parallel_job* jobs = (struct parallel_job*)calloc((size_t)count, sizeof(struct parallel_job));
+        if (jobs == NULL) {
+            perror("calloc failed");
+            exit(1);
+        }
+        for (int i = 0; i < count; i++) {
+            jobs[i].group = groups[i];
+            jobs[i].fds[0] = jobs[i].fds[1] = -1;
+        }
+        int failed = runJobs(jobs, count);
+        fflush(stdout);
+        exit(failed > PARALLEL_FAILED_MAX ? PARALLEL_FAILED_MAX : failed);
+    }
+
+    // Parent: the leader's group exists before anyone signals it, as for '&'
+    setpgid(leader, leader);
+    char* name = batchName(groups, count);
+    if (background) {
+        int job_num = addJob(leader, name ? name : "parallel", 1);
+        if (job_num != -1) printf("[%d] %d\n", job_num, leader);
+        fflush(stdout);
+        free(name);
+        return;
+    }
+
+    if (isatty(STDIN_FILENO)) tcsetpgrp(STDIN_FILENO, leader);
+    int status = 0;
+    if (foregroundWaitHook) foregroundWaitHook();
+    // The leader reaps every job, so its usage covers the whole batch
+    struct stage_usage usage;
+    usageStart(&usage);
+    reaperWaitPidsUsage(&leader, 1, &status, &usage);
+    if (timingAlways && usage.measured) usageLineAdd(&usage, 1);
+    if (isatty(STDIN_FILENO)) tcsetpgrp(STDIN_FILENO, getpgrp());
+    if (WIFSTOPPED(status)) {
+        int job_num = addJob(leader, name ? name : "parallel", 0);
+        if (job_num != -1) {
+            printf("[%d] Stopped %s\n", job_num, name ? name : "parallel");
+            fflush(stdout);
+        }
+    } else {
+        lastExitStatus = exitStatusOf(status);
+        if (WIFEXITED(status) && lastExitStatus > 0) {
+            fprintf(stderr, "parallel: %s%d of %d jobs failed\n",
+                    lastExitStatus == PARALLEL_FAILED_MAX ? "at least " : "", lastExitStatus, count);
+        }
+    }
+    free(name);
+}
\ No newline at end of file
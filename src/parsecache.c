@@ -0,0 +1,170 @@
+#include "../include/parsecache.h"
+#include "../include/lexer.h"
+#include "../include/revealcache.h"
+#include "../include/stats.h"
+
+struct parse_cache_stats parseCacheStats = {0};
+
+static struct parse_cache_entry* buckets[PARSE_CACHE_BUCKETS];
+static struct parse_cache_entry* lruHead = NULL; // most recently used
+static struct parse_cache_entry* lruTail = NULL; // next to be evicted
+
+
+// 64-bit FNV-1a
+uint64_t hashLine(const char* line, size_t length){
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)line[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static void lruUnlink(struct parse_cache_entry* entry){
+    if (entry->lruPrev) entry->lruPrev->lruNext = entry->lruNext; else lruHead = entry->lruNext;
+    if (entry->lruNext) entry->lruNext->lruPrev = entry->lruPrev; else lruTail = entry->lruPrev;
+    entry->lruPrev = NULL;
+    entry->lruNext = NULL;
+}
+
+static void lruPushFront(struct parse_cache_entry* entry){
+    entry->lruPrev = NULL;
+    entry->lruNext = lruHead;
+    if (lruHead) lruHead->lruPrev = entry; else lruTail = entry;
+    lruHead = entry;
+}
+
+static void evictLeastRecent(void){
+    struct parse_cache_entry* victim = lruTail;
+    if (victim == NULL) return;
+    lruUnlink(victim);
+
+    struct parse_cache_entry** link = &buckets[victim->hash & (PARSE_CACHE_BUCKETS - 1)];
+    while (*link && *link != victim) link = &(*link)->bucketNext;
+    if (*link) *link = victim->bucketNext;
+
+    free(victim->plan);
+    free(victim->line);
+    free(victim);
+    parseCacheStats.entries--;
+    parseCacheStats.evictions++;
+}
+
+
+// Find line's entry and mark it most recently used, without counting the lookup
+static struct parse_cache_entry* probe(const char* line){
+    size_t length = strlen(line);
+    uint64_t hash = hashLine(line, length);
+    struct parse_cache_entry* entry = buckets[hash & (PARSE_CACHE_BUCKETS - 1)];
+    while (entry) {
+        if (entry->hash == hash && (size_t)entry->lineLength == length
+            && memcmp(entry->line, line, length) == 0) {
+            lruUnlink(entry);
+            lruPushFront(entry);
+            return entry;
+        }
+        entry = entry->bucketNext;
+    }
+    return NULL;
+}
+
+struct plan* parseCacheLookup(const char* line){
+    struct parse_cache_entry* entry = probe(line);
+    // A line compiled ahead was still a miss: the cache did not already know it
+    if (entry != NULL && !entry->prepared) parseCacheStats.hits++;
+    else parseCacheStats.misses++;
+    if (entry == NULL) return NULL;
+    entry->prepared = false;
+    return entry->plan;
+}
+
+
+bool parseCacheInsert(const char* line, struct plan* plan){
+    struct parse_cache_entry* entry = (struct parse_cache_entry*)malloc(sizeof(struct parse_cache_entry));
+    if (entry == NULL) return false;
+    size_t length = strlen(line);
+    entry->line = strndup(line, length);
+    if (entry->line == NULL) {
+        free(entry);
+        return false;
+    }
+    entry->lineLength = (int)length;
+    entry->hash = hashLine(line, length);
+    entry->plan = plan;
+    entry->prepared = false;
+
+    // The entry being executed right now is the most recent one, so it is never the victim
+    if (parseCacheStats.entries >= PARSE_CACHE_CAPACITY) evictLeastRecent();
+
+    struct parse_cache_entry** bucket = &buckets[entry->hash & (PARSE_CACHE_BUCKETS - 1)];
+    entry->bucketNext = *bucket;
+    *bucket = entry;
+    lruPushFront(entry);
+    parseCacheStats.entries++;
+    return true;
+}
+
+struct plan* cachedCompileCommand(char* inputCommand){
+    struct plan* plan = parseCacheLookup(inputCommand);
+    if (plan != NULL) return plan;
+
+    // Invalid lines are not cached so that they keep reporting their syntax error.
+    // The tree itself lives in parseArena; only the compiled blob is kept.
+    uint64_t start = statsNow();
+    struct shell_cmd* shellCmdStruct = verifyCommand(inputCommand);
+    statsRecord(STATS_PARSE, start);
+    if (shellCmdStruct == NULL || !shellCmdStruct->validity) return NULL;
+    plan = compilePlan(shellCmdStruct);
+    if (plan == NULL) return NULL;
+    if (!parseCacheInsert(inputCommand, plan)) {
+        free(plan);
+        return NULL;
+    }
+    return plan;
+}
+
+void prepareCommand(char* inputCommand){
+    // Not counted: the line's real run does the lookup that counts
+    if (probe(inputCommand) != NULL) return;
+
+    // Same as cachedCompileCommand minus the error report: an invalid line is
+    // left uncached and reports itself when it is actually run
+    struct shell_cmd* shellCmdStruct = lexShellCommand(inputCommand, &parseArena);
+    if (shellCmdStruct == NULL || !shellCmdStruct->validity) return;
+    struct plan* plan = compilePlan(shellCmdStruct);
+    if (plan == NULL) return;
+    if (!parseCacheInsert(inputCommand, plan)) free(plan);
+    else lruHead->prepared = true;
+}
+
+void executeCache(int argc, char** argv){
+    if (argc == 2 && strcmp(argv[1], "clear") == 0) {
+        // Only the reveal listings: the plan running this builtin is itself in the parse cache
+        revealCacheClear();
+        return;
+    }
+    if (argc != 1) {
+        fprintf(stderr, "Invalid syntax!\n");
+        return;
+    }
+
+    unsigned long lookups = parseCacheStats.hits + parseCacheStats.misses;
+    printf("parse cache: %d/%d entries, %lu hits, %lu misses, %lu evictions, hit rate %.1f%%\n",
+           parseCacheStats.entries, PARSE_CACHE_CAPACITY,
+           parseCacheStats.hits, parseCacheStats.misses, parseCacheStats.evictions,
+           lookups ? 100.0 * parseCacheStats.hits / lookups : 0.0);
+
+    lookups = revealCacheStats.hits + revealCacheStats.misses;
+    printf("reveal cache: %d/%d listings, %.1f KiB, %lu hits, %lu misses (%lu stale), %lu evictions, hit rate %.1f%%\n",
+           revealCacheStats.entries, REVEAL_CACHE_CAPACITY, revealCacheStats.bytes / 1024.0,
+           revealCacheStats.hits, revealCacheStats.misses, revealCacheStats.invalidations, revealCacheStats.evictions,
+           lookups ? 100.0 * revealCacheStats.hits / lookups : 0.0);
+
+    // What parsing costs the allocator: arena allocations are free, chunk mallocs are not
+    unsigned long commands = parseArena.resetCount;
+    printf("parse arena: %lu allocations, %lu mallocs over %lu commands (%.1f allocations, %.2f mallocs per command), high water %.1f KiB\n",
+           parseArena.allocCount, parseArena.mallocCount, commands,
+           commands ? (double)parseArena.allocCount / commands : 0.0,
+           commands ? (double)parseArena.mallocCount / commands : 0.0,
+           parseArena.highWater / 1024.0);
+}
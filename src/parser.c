@@ -1,4 +1,5 @@
 #include "../include/parser.h"
+#include "../include/lexer.h"
 
 
 void freeTerminal(struct terminal* terminalGroup){
@@ -86,6 +87,8 @@ void freeCmdGroup(struct cmd_group* cmdGroup){
 
 void freeShellCmd(struct shell_cmd* shellCommand){
     if (shellCommand == NULL) return;
+    // Arena-backed trees are released all at once by arenaReset
+    if (shellCommand->arena != NULL) return;
 
     // Free cmdGroupArr
     if (shellCommand->cmdGroupArr != NULL) {
@@ -120,19 +123,7 @@ void freeShellCmd(struct shell_cmd* shellCommand){
 
 // helper function to check if a character is whitespace
 bool isWhitespace(char c) {
-    regex_t regex;
-    int reti;
-    char str[2] = {c, '\0'};
-
-    // Compile regex for whitespace
-    reti = regcomp(&regex, "[[:space:]]", REG_NOSUB | REG_EXTENDED);
-    if (reti) return false;
-
-    // Execute regex
-    reti = regexec(&regex, str, 0, NULL, 0);
-    regfree(&regex);
-
-    return reti == 0;
+    return (lexCharClass[(unsigned char)c] & CC_SPACE) != 0;
 }
 
 struct shell_cmd* tokenizeShellCommand(char* shellCommandString){
@@ -148,6 +139,10 @@ struct shell_cmd* tokenizeShellCommand(char* shellCommandString){
     shellCommand->cmdArrIndex = 0;
     shellCommand->sepArrIndex = 0;
     shellCommand->validity = false;
+    shellCommand->arena = NULL;
+    shellCommand->source = NULL;
+    shellCommand->argBuffer = NULL;
+    shellCommand->lineLength = 0;
 
     // Allocate initial memory for cmdGroupArr and separatorArr
     int initialSize = 10; // Initial size, can be adjusted
@@ -198,8 +193,9 @@ struct shell_cmd* tokenizeShellCommand(char* shellCommandString){
             cmdGroupInstance->cmdString[temp - cmdInstanceStart] = shellCommandString[temp];
         }
         cmdGroupInstance->cmdString[cmdInstanceLength] = '\0'; // null-terminate the string
+        cmdGroupInstance->cmdLength = cmdInstanceLength;
         
-        char* separatorChar = (char*)malloc(2 * sizeof(char));
+        char* separatorChar = (char*)malloc(4 * sizeof(char));
         if (separatorChar == NULL) {
             //perror("Failed to allocate memory for separatorChar");
             // functions to free memory at each level
@@ -208,6 +204,10 @@ struct shell_cmd* tokenizeShellCommand(char* shellCommandString){
 
         separatorChar[0] = shellCommandString[i]; // stopped when ; or & was reached
         separatorChar[1] = '\0';
+        if (i + 2 < stringLength && strncmp(shellCommandString + i, "&&&", 3) == 0) {
+            strcpy(separatorChar, "&&&"); // parallel batch
+            i += 2;
+        }
 
         // Add cmdGroupInstance and separatorChar to shellCommand's arrays
         if (shellCommand->cmdArrIndex >= initialSize) {
@@ -340,6 +340,7 @@ struct cmd_group* tokenizeCmdGroup(struct cmd_group* cmdGroup){
             atomicInstance->atomicString[temp - atomicInstanceStart] = cmdString[temp];
         }
         atomicInstance->atomicString[atomicInstanceLength] = '\0'; // null-terminate the string
+        atomicInstance->atomicLength = atomicInstanceLength;
 
         char* separatorChar = (char*)malloc(2 * sizeof(char));
         if (separatorChar == NULL) {
@@ -467,6 +468,7 @@ struct atomic* tokenizeAtomic(struct atomic* atomicGroup){
         }
         strncpy(terminalInstance->terminalString, &atomicString[termInstanceStart], termInstanceLength);
         terminalInstance->terminalString[termInstanceLength] = '\0'; // null-terminate the string
+        terminalInstance->terminalLength = termInstanceLength;
 
 
         char* separatorChar = (char*)malloc(2 * sizeof(char));
@@ -791,51 +793,19 @@ void testAllTokenizers(){
     printf("}\n");
 }
 
+struct arena parseArena = { .chunkSize = ARENA_CHUNK_SIZE };
+
 struct shell_cmd* verifyCommand(char* inputCommand){
-    // Generate and fill in a shell_cmd struct for this inputCommand
-    struct shell_cmd* shellResult = tokenizeShellCommand(inputCommand);
+    // Build the whole shell_cmd tree (and its validity) in a single scan of the input.
+    // The tokenize*/check* chain above is kept for the test helpers and gives the same verdict.
+    // All of it lives in parseArena until main() resets it after execution.
+    struct shell_cmd* shellResult = lexShellCommand(inputCommand, &parseArena);
     if (shellResult == NULL) {
         //printf("Shell command tokenization failed.\n");
         return NULL;
     }
 
-    for (int i = 0; i < shellResult->cmdArrIndex; i++) {
-        //printf("Tokenizing command group %d of %d: %s\n", i+1, shellResult->cmdArrIndex, shellResult->cmdGroupArr[i]->cmdString);
-        
-        // For each cmd_group in shell_cmd's cmd_group array, tokenize it into its atomics (fill in this cmd_group struct fully with its atomic arrays)
-        // tokenize shell command function only put cmd_strings into cmd_group structs -> tokenize further and fill in the atomics array
-        struct cmd_group* cmdGroupResult = tokenizeCmdGroup(shellResult->cmdGroupArr[i]);
-        if (cmdGroupResult == NULL) {
-            //printf("Cmd group tokenization failed for command group %d.\n", i + 1);
-            return shellResult;
-        }
-        
-        shellResult->cmdGroupArr[i] = cmdGroupResult; // redundant?
-
-        // Take this filled in cmd_group, and for each atomic in the atomic array, tokenize it further down
-        for (int j = 0; j < cmdGroupResult->atomicArrIndex; j++) {
-            struct atomic* atomicResult = tokenizeAtomic(cmdGroupResult->atomicArr[j]);
-            if (atomicResult == NULL) {
-                //printf("Atomic tokenization failed for atomic command %d in command group %d.\n", j + 1, i + 1);
-                return shellResult;
-            }
-            cmdGroupResult->atomicArr[j] = atomicResult;
-            for (int k = 0; k < atomicResult->termArrIndex; k++) {
-                struct terminal* terminalResult = tokenizeTerminal(atomicResult->terminalArr[k]);
-                if (terminalResult == NULL) {
-                    //printf("Terminal tokenization failed for terminal %d in atomic command %d of command group %d.\n", k + 1, j + 1, i + 1);
-                    return shellResult;
-                }
-                atomicResult->terminalArr[k] = terminalResult; // Redundant???
-            }
-        }
-    }
-
-
-
-    bool valid = checkShellCmd(shellResult);
-
-    if (valid) {
+    if (shellResult->validity) {
         //printf("Valid Syntax!\n");
     } else {
         printf("Invalid Syntax!\n");
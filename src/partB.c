@@ -4,43 +4,29 @@ char* absoluteHomePath = NULL; // Global variable to hold the absolute home path
 
 char* oldWD = NULL;
 
-static int cmp(const void* a, const void* b) {
-    return strcmp(*(char**)a, *(char**)b);
-}
-
-
-void executeHop(struct atomic* atomicCmd){
+void executeHop(int argCount, char** args){
     //printf("entered executeHop\n");
-    char* currentWD = getcwd(NULL, 0);
-    if (currentWD == NULL){
-        perror("getcwd() error");
-        return;
-    }
-
-    struct terminal* terminalCmd = atomicCmd->terminalArr[0];
-    int argCount = terminalCmd->cmdAndArgsIndex;
-    char** args = terminalCmd->cmdAndArgs;
-
+    // currentWD is kept up to date by cwdChange (see cwd.h); no getcwd needed
     if (argCount < 2) {
         // go to home directory
-        if (chdir(absoluteHomePath) != 0) {
+        char* previous = cwdChange(absoluteHomePath, true);
+        if (previous == NULL) {
             perror("hop: chdir to home directory failed");
-            free(currentWD);
             return;
         }
+        free(previous);
     }
 
     for (int i = 1; i < argCount; i++) {
+        char* previous = NULL;
         if (strcmp(args[i], "-") == 0) {
             if (oldWD == NULL) {
                 //perror("hop: OLDPWD not set\n");
-                free(currentWD);
                 return;
             }
-            if (chdir(oldWD) != 0) {
+            previous = cwdChange(oldWD, true);
+            if (previous == NULL) {
                 //perror("hop: chdir to OLDPWD failed\n");
-                chdir(currentWD); // revert to current directory
-                free(currentWD);
                 return;
             }
             //printf("%s\n", oldWD);
@@ -50,49 +36,40 @@ void executeHop(struct atomic* atomicCmd){
             continue;
         }
         else if (strcmp(args[i], "..")==0){
-            // go to parent directory
-            if (chdir("..") != 0) {
+            // go to parent directory: currentWD is canonical, so it is just the path minus its last component
+            char* parent = cwdParent();
+            if (parent == NULL) return;
+            previous = cwdChange(parent, true);
+            free(parent);
+            if (previous == NULL) {
                 //perror("hop: chdir to parent directory failed\n");
-                chdir(currentWD); // revert to current directory
-                free(currentWD);
                 return;
             }
         }
         else if (strcmp(args[i], "~")==0){
             // go to home directory
-            if (chdir(absoluteHomePath) != 0) {
+            previous = cwdChange(absoluteHomePath, true);
+            if (previous == NULL) {
                 perror("hop: chdir to home directory failed");
-                chdir(currentWD); // revert to current directory
-                free(currentWD);
                 return;
             }
         }
         else {
             // go to specified directory
-            if (chdir(args[i]) != 0) {
+            previous = cwdChange(args[i], false);
+            if (previous == NULL) {
                 printf("No such directory!\n");
-                chdir(currentWD); // revert to current directory
-                free(currentWD);
                 return;
             }
         }
         // Update oldWD after a successful directory change
         free(oldWD);
-        oldWD = currentWD;
-        currentWD = getcwd(NULL, 0);
-        if (currentWD == NULL){
-            perror("getcwd() error");
-            return;
-        }
+        oldWD = previous;
     }
 
 }
 
-bool checkRevealSyntax(struct atomic* atomicGroup) {
-    struct terminal* terminalCmd = atomicGroup->terminalArr[0];
-    int argCount = terminalCmd->cmdAndArgsIndex;
-    char** args = terminalCmd->cmdAndArgs;
-
+bool checkRevealSyntax(int argCount, char** args) {
     // Must have at least the command "reveal"
     if (argCount < 1 || strcmp(args[0], "reveal") != 0) {
         return false;
@@ -101,9 +78,9 @@ bool checkRevealSyntax(struct atomic* atomicGroup) {
     int pathFound = 0;
     for (int i = 1; i < argCount; i++) {
         if (args[i][0] == '-') {
-            // Check if it's a valid flag: - followed by a, l, or combinations
+            // Check if it's a valid flag: - followed by a, l, R, or combinations
             for (int j = 1; args[i][j] != '\0'; j++) {
-                if (args[i][j] != 'a' && args[i][j] != 'l') {
+                if (args[i][j] != 'a' && args[i][j] != 'l' && args[i][j] != 'R') {
                     return false; // Invalid character in flag
                 }
             }
@@ -119,12 +96,8 @@ bool checkRevealSyntax(struct atomic* atomicGroup) {
     return true;
 }
 
-void executeReveal(struct atomic* atomicGroup){
-    struct terminal* terminalCmd = atomicGroup->terminalArr[0];
-    int argCount = terminalCmd->cmdAndArgsIndex;
-    char** args = terminalCmd->cmdAndArgs;
-
-    if (!checkRevealSyntax(atomicGroup)) {
+void executeReveal(int argCount, char** args){
+    if (!checkRevealSyntax(argCount, args)) {
         fprintf(stderr, "reveal: Invalid Syntax!\n");
         return;
     }
@@ -132,6 +105,7 @@ void executeReveal(struct atomic* atomicGroup){
     // Flags to indicate display formats..?
     int allFlag = 0;
     int lineFlag = 0;
+    int recursiveFlag = 0;
 
     char* dirPath = NULL;
     int dirPath_allocated = 0; // 1 if dirPath should be freed
@@ -144,6 +118,9 @@ void executeReveal(struct atomic* atomicGroup){
         if (args[i][0]=='-' && strstr(args[i], "l") != NULL) {
             lineFlag = 1;
         }
+        if (args[i][0]=='-' && strstr(args[i], "R") != NULL) {
+            recursiveFlag = 1;
+        }
         if (args[i][0]=='-' && ((strstr(args[i], "al") != NULL || strstr(args[i], "la") != NULL))) {
             allFlag = 1;
             lineFlag = 1;
@@ -161,21 +138,11 @@ void executeReveal(struct atomic* atomicGroup){
             dirPath = absoluteHomePath;
             dirPath_allocated = 0;
         }
-        else if (strcmp(args[i], ".") == 0) {
-            dirPath = getcwd(NULL, 0);
-            if (dirPath == NULL) {
-                //perror("getcwd() error");
-                return;
-            }
-            dirPath_allocated = 1;
-        }
-        else if (strcmp(args[i], "..") == 0) {
-            dirPath = realpath("..", NULL);
-            if (dirPath == NULL) {
-                //perror("realpath() error");
-                return;
-            }
-            dirPath_allocated = 1;
+        else if (strcmp(args[i], ".") == 0 || strcmp(args[i], "..") == 0) {
+            // Open the directory the process is really in: currentWD is only what it
+            // was called when we entered it, and it may have been moved or replaced since
+            dirPath = args[i];
+            dirPath_allocated = 0;
         }
         else if (args[i][0] != '-') {
             dirPath = args[i];
@@ -184,237 +151,130 @@ void executeReveal(struct atomic* atomicGroup){
     }
 
     if (dirPath == NULL){
-        dirPath = getcwd(NULL, 0);
-        if (dirPath == NULL) {
-            //perror("getcwd() failed for CWD");
-            return;
-        }
-        dirPath_allocated = 1;
-        //printf("DEBUG: dirPath set to CWD: %s\n", dirPath);  // Add this for debugging
+        dirPath = ".";
+        dirPath_allocated = 0;
     }
 
     // If dirPath refers to a regular file (or non-directory), print its name like ls
     struct stat st;
-    if (stat(dirPath, &st) == 0 && !S_ISDIR(st.st_mode)) {
-        if (lineFlag) printf("%s\n", dirPath);
+    bool statOk = (stat(dirPath, &st) == 0);
+    if (statOk && !S_ISDIR(st.st_mode)) {
+        if (lineFlag) revealPrintLongFile(dirPath);
         else { printf("%s\n", dirPath); } // keep simple one-per-line for file target
         if (dirPath_allocated) free(dirPath);
         return;
     }
 
-    DIR* dir = opendir(dirPath);
-    struct dirent* entry;
-    if (dir == NULL) {
-        // If cannot open directory and it's not a regular file, just silently return
-        if (dirPath_allocated) free(dirPath);
-        return;
-    }
-
-    // Collect entries
-    char** names = NULL;
-    int count = 0;
-    int capacity = 10;
-    names = malloc(capacity * sizeof(char*));
-    if (!names) {
-        perror("malloc failed");
-        closedir(dir);
+    if (recursiveFlag) {
+        revealWalk(dirPath, allFlag, lineFlag);
         if (dirPath_allocated) free(dirPath);
         return;
     }
 
-    while ((entry = readdir(dir)) != NULL) {
-        // Skip hidden files unless -a flag is set
-        if (!allFlag && entry->d_name[0] == '.') {
-            continue;
-        }
-        if (count >= capacity) {
-            capacity *= 2;
-            names = realloc(names, capacity * sizeof(char*));
-            if (!names) {
-                perror("realloc failed");
-                closedir(dir);
-                if (dirPath_allocated) free(dirPath);
-                return;
-            }
-        }
-        names[count++] = strdup(entry->d_name);
-    }
-    closedir(dir);
-
-    // Sort case-insensitively
-    qsort(names, count, sizeof(char*), cmp);
-
-    // Print
-    for (int i = 0; i < count; i++) {
-        if (lineFlag) {
-            printf("%s\n", names[i]);
-        } else {
-            printf("%s  ", names[i]);
+    // Collect, sort and print entries (see reveal.h), unless the directory is unchanged
+    // since it was last shown (see revealcache.h)
+    struct reveal_listing listing;
+    memset(&listing, 0, sizeof(listing));
+    const struct reveal_entry* cached = statOk ? revealCacheLookup(&st, allFlag, &listing.count) : NULL;
+    if (cached != NULL) {
+        listing.entries = (struct reveal_entry*)cached;
+    } else {
+        if (!revealCollect(&listing, dirPath, allFlag)) {
+            // If cannot open directory and it's not a regular file, just silently return
+            if (dirPath_allocated) free(dirPath);
+            return;
         }
-        free(names[i]);
+        revealSort(listing.entries, listing.count);
+        if (statOk) revealCacheInsert(&st, allFlag, &listing);
     }
-    if (!lineFlag) {
-        printf("\n");
-    }
-    free(names);
+    if (lineFlag) revealPrintLong(&listing, dirPath);
+    else revealPrint(&listing, false);
+    if (cached == NULL) revealFree(&listing);
     if (dirPath_allocated) free(dirPath);
 }
 
-void executeLog(struct atomic* atomicCmd){
-    struct terminal* terminalCmd = atomicCmd->terminalArr[0];
-    int argCount = terminalCmd->cmdAndArgsIndex;
-    char** args = terminalCmd->cmdAndArgs;
-
+void executeLog(int argCount, char** args){
+    historyRefresh();
     if (argCount == 1) {
-        // No arguments: print the log
-        struct executedShellCommand* current = listHead;
-        while (current != NULL) {
-            printf("%s\n", current->shellCommandString);
-            current = current->next;
+        // No arguments: print the log, oldest first
+        for (int index = historyCount(); index >= 1; index--) {
+            const char* entry = historyEntry(index);
+            if (entry != NULL) printf("%s\n", entry);
         }
+    } else if (argCount == 2 && strcmp(args[1], "time") == 0) {
+        // time: the log with what each command cost, where it was measured
+        printLogUsage();
     } else if (argCount == 2 && strcmp(args[1], "purge") == 0) {
-        // purge: clear the log
-        struct executedShellCommand* current = listHead;
-        while (current != NULL) {
-            struct executedShellCommand* temp = current;
-            current = current->next;
-            free(temp->shellCommandString);
-            free(temp);
-        }
-        listHead = NULL;
-        listTail = NULL;
-        logListSize = 0;
-        saveLog();
+        // purge: clear the log (for every shell sharing it)
+        historyClear();
     } else if (argCount == 3 && strcmp(args[1], "execute") == 0) {
-        // execute <index>
+        // execute <index>: index 1 is newest
         int index = atoi(args[2]);
-        if (index < 1 || index > logListSize) {
+        const char* entry = historyEntry(index);
+        if (entry == NULL) {
             fprintf(stderr, "log: invalid index\n");
             return;
         }
-        // Find the command: index 1 is newest (tail), index logListSize is oldest (head)
-        int target = logListSize - index + 1; // 1-based from head
-        struct executedShellCommand* current = listHead;
-        for (int i = 1; i < target; i++) {
-            current = current->next;
-        }
-        char* cmd = current->shellCommandString;
+        char* cmd = strdup(entry); // the entry is a copy that the next history lookup reuses
         // Execute without adding to log
-        struct shell_cmd* shellCmdStruct = verifyCommand(cmd);
-        if (shellCmdStruct->validity) {
-            executeShellCommand(shellCmdStruct);
+        // Cached plan, or parsed (into parseArena, released with the outer command) and compiled
+        struct plan* plan = cachedCompileCommand(cmd);
+        if (plan != NULL) {
+            executeShellCommand(plan);
         }
-        freeShellCmd(shellCmdStruct);
+        free(cmd);
+    } else if (argCount >= 3 && strcmp(args[1], "search") == 0) {
+        // search <substring>: the remaining words, joined by single spaces
+        size_t length = 0;
+        for (int i = 2; i < argCount; i++) length += strlen(args[i]) + 1;
+        char* needle = (char*)malloc(length);
+        if (needle == NULL) {
+            perror("malloc failed");
+            return;
+        }
+        needle[0] = '\0';
+        for (int i = 2; i < argCount; i++) {
+            if (i > 2) strcat(needle, " ");
+            strcat(needle, args[i]);
+        }
+        executeLogSearch(needle);
+        free(needle);
     } else {
         printf("log: invalid syntax\n");
     }
 }
 
-char* logFile = "/home/saikapilbharadwaj/Documents/OSN/mini-project-1-StatewideOwl3/shell/logs.txt";
-int logListSize = 0;
-struct executedShellCommand* listHead = NULL;
-struct executedShellCommand* listTail = NULL;
 
+// History capacity: MAX_HISTORY, or HISTSIZE if set to a sane value
+static int configuredCapacity(void){
+    const char* size = getenv("HISTSIZE");
+    if (size == NULL) return MAX_HISTORY;
+    char* end = NULL;
+    long capacity = strtol(size, &end, 10);
+    if (end == size || *end != '\0' || capacity < 1 || capacity > HISTORY_MAX_CAPACITY) return MAX_HISTORY;
+    return (int)capacity;
+}
 
-// Function to implement persistence feature for storing 15 most recent shell commands across sessions
+// Function to implement persistence feature for storing the most recent shell commands across sessions:
+// map the shared history store in the shell's home directory (nothing is read in)
 void loadLogs(){
-    // Start by constructing path string to files
-    char* path = (char*)malloc(strlen(absoluteHomePath) + strlen("/logs.txt") + 1);
-    strcpy(path, absoluteHomePath);
-    strcat(path, "/logs.txt");
-
-    
-    FILE* file = fopen(logFile, "r");
-    if (file == NULL) {
-        // If the file doesn't exist, it's not an error; just return
-        return;
-    }
-
-    char buffer[1024];
-    // Read one line in the file (one command) at a time and process them
-    while (fgets(buffer, sizeof(buffer), file)) {
-        // Remove newline character if present
-        size_t len = strlen(buffer);
-        if (len > 0 && buffer[len - 1] == '\n') {
-            buffer[len - 1] = '\0';
-        }
-
-        // Store the command locally in struct (string, next)
-        struct executedShellCommand* newLog = malloc(sizeof(struct executedShellCommand));
-        newLog->shellCommandString = strdup(buffer); // Make copy in memory (buffer will die after exiting this func)
-        newLog->next = NULL;
-
-        // listHead is the HEAD of the LL storing last 15 most recent commands across sessions
-        if (listHead == NULL) {
-            // If the list is empty (i.e just began loading from file), the new log is both the head and tail
-            listHead = newLog;
-            listTail = newLog;
-            logListSize++;
-        } 
-        else if (logListSize < 15) {
-            // Otherwise, append the new log to the end of the list
-            listTail->next = newLog;
-            listTail = newLog;
-            logListSize++;
-        }
-        else if (logListSize >= 15) {
-            // Remove the oldest log (head) and append the new log to the end
-            struct executedShellCommand* temp = listHead;
-            listHead = listHead->next;
-            free(temp->shellCommandString);
-            free(temp);
-            listTail->next = newLog;
-            listTail = newLog;
-        }
-    }
-
-    fclose(file);
+    historyOpen(absoluteHomePath, configuredCapacity(), getenv("HISTSIZE") != NULL);
 }
 
+// Entries are written as they are added; this only syncs them per historySyncPolicy.
+// Called at the prompt.
 void saveLog(){
-    char* path = (char*)malloc(strlen(absoluteHomePath) + strlen("/logs.txt") + 1);
-    strcpy(path, absoluteHomePath);
-    strcat(path, "/logs.txt");
-    FILE* file = fopen(logFile, "w+");
-    if (file == NULL) {
-        perror("Failed to open log file for writing");
-        return;
-    }
-
-    struct executedShellCommand* current = listHead;
-    while (current != NULL) {
-        fprintf(file, "%s\n", current->shellCommandString);
-        current = current->next;
-    }
+    uint64_t start = statsNow();
+    historySync(false);
+    statsRecord(STATS_HISTORY, start);
+}
 
-    fclose(file);
+void closeLogs(){
+    historyClose();
 }
 
 void addLog(char* commandString) {
-    struct executedShellCommand* newLog = malloc(sizeof(struct executedShellCommand));
-    newLog->shellCommandString = strdup(commandString);
-    newLog->next = NULL;
-
-    if (listHead == NULL) {
-        // If the list is empty, the new log is both the head and tail
-        listHead = newLog;
-        listTail = newLog;
-        logListSize++;
-    } 
-    else if (logListSize < 15) {
-        // Otherwise, append the new log to the end of the list
-        listTail->next = newLog;
-        listTail = newLog;
-        logListSize++;
-    }
-    else if (logListSize >= 15) {
-        // Remove the oldest log (head) and append the new log to the end
-        struct executedShellCommand* temp = listHead;
-        listHead = listHead->next;
-        free(temp->shellCommandString);
-        free(temp);
-        listTail->next = newLog;
-        listTail = newLog;
-    }
-    saveLog(); // Save the updated log list to the file
+    uint64_t start = statsNow();
+    historyPush(commandString, strlen(commandString));
+    statsRecord(STATS_HISTORY, start);
 }
\ No newline at end of file
@@ -1,82 +1,129 @@
 #include "../include/partE.h"
-#include <sys/wait.h>
-#include <errno.h>
 
 struct job* job_list = NULL;
-struct job* jobListTail = NULL;
+struct job* jobListTail = NULL; // most recent job
+int jobCount = 0;
+static int next_job_num = 1;
 
+static struct job** pidBuckets = NULL;
+static struct job** numBuckets = NULL;
+static size_t bucketCount = 0;
 
-// Add a job to the list
-void addJob(pid_t pid, char *cmd, int running) {
+
+static size_t hashKey(unsigned int key) {
+    return (size_t)(key * 2654435761u) & (bucketCount - 1);
+}
+
+static void hashInsert(struct job* job) {
+    size_t p = hashKey((unsigned int)job->pid);
+    job->pidNext = pidBuckets[p];
+    pidBuckets[p] = job;
+    size_t n = hashKey((unsigned int)job->job_num);
+    job->numNext = numBuckets[n];
+    numBuckets[n] = job;
+}
+
+// Double the bucket arrays (or create them) and rehash every live job
+static int growTable(void) {
+    size_t newCount = bucketCount ? bucketCount * 2 : JOB_TABLE_MIN_BUCKETS;
+    struct job** newPid = calloc(newCount, sizeof(struct job*));
+    struct job** newNum = calloc(newCount, sizeof(struct job*));
+    if (!newPid || !newNum) {
+        free(newPid);
+        free(newNum);
+        return -1;
+    }
+    free(pidBuckets);
+    free(numBuckets);
+    pidBuckets = newPid;
+    numBuckets = newNum;
+    bucketCount = newCount;
+    for (struct job* j = job_list; j; j = j->next) hashInsert(j);
+    return 0;
+}
+
+// Add a job to the table
+int addJob(pid_t pid, char *cmd, int running) {
     //printf("adding job : %d %s %d", pid, cmd, running);
+    // One entry per process group: a job that is already known keeps its number
+    struct job* existing = findJobByPid(pid);
+    if (existing) {
+        existing->running = running;
+        return existing->job_num;
+    }
+    if ((size_t)jobCount >= bucketCount) {
+        // Keep chains short; failing to grow only matters before the first table exists
+        if (growTable() != 0 && bucketCount == 0) return -1;
+    }
     struct job *new_job = malloc(sizeof(struct job));
+    if (!new_job) return -1;
+    new_job->job_num = next_job_num++;
     new_job->pid = pid;
-    new_job->command = strdup(cmd);
+    new_job->command = strdup(cmd ? cmd : "(null)");
     new_job->running = running;
-    new_job->next = job_list;
-    job_list = new_job;
+    new_job->status = 0;
+
+    new_job->next = NULL;
+    new_job->prev = jobListTail;
+    if (jobListTail) jobListTail->next = new_job; else job_list = new_job;
+    jobListTail = new_job;
+    hashInsert(new_job);
+    jobCount++;
+    return new_job->job_num;
+}
+
+struct job* findJobByPid(pid_t pid) {
+    if (bucketCount == 0) return NULL;
+    struct job* j = pidBuckets[hashKey((unsigned int)pid)];
+    while (j && j->pid != pid) j = j->pidNext;
+    return j;
+}
+
+struct job* findJobByNum(int job_num) {
+    if (bucketCount == 0) return NULL;
+    struct job* j = numBuckets[hashKey((unsigned int)job_num)];
+    while (j && j->job_num != job_num) j = j->numNext;
+    return j;
+}
+
+struct job* mostRecentJob(void) {
+    return jobListTail;
+}
+
+struct job* detachJob(pid_t pid) {
+    struct job* job = findJobByPid(pid);
+    if (!job) return NULL;
+
+    struct job** link = &pidBuckets[hashKey((unsigned int)job->pid)];
+    while (*link != job) link = &(*link)->pidNext;
+    *link = job->pidNext;
+    link = &numBuckets[hashKey((unsigned int)job->job_num)];
+    while (*link != job) link = &(*link)->numNext;
+    *link = job->numNext;
+
+    if (job->prev) job->prev->next = job->next; else job_list = job->next;
+    if (job->next) job->next->prev = job->prev; else jobListTail = job->prev;
+    job->next = job->prev = job->pidNext = job->numNext = NULL;
+    jobCount--;
+    return job;
+}
+
+void freeJob(struct job* job) {
+    if (!job) return;
+    free(job->command);
+    free(job);
 }
 
-// Remove a job from the list (when terminated)
+// Remove a job from the table (when terminated)
 void removeJob(pid_t pid) {
-    struct job **curr = &job_list;
-    while (*curr) {
-        if ((*curr)->pid == pid) {
-            struct job *tmp = *curr;
-            *curr = (*curr)->next;
-            free(tmp->command);
-            free(tmp);
-            return;
-        }
-        curr = &((*curr)->next);
-    }
+    freeJob(detachJob(pid));
 }
 
-// Update job states using waitpid
+// Job states are kept current by the reaper; just collect anything still pending
 void updateJobs() {
-    struct job *j = job_list;
-    int status;
-    while (j) {
-        // Avoid reaping background jobs that are managed by check_bg_jobs(), so
-        // that their termination message is printed there. If we called waitpid
-        // here first, we'd consume the exit status and suppress that message.
-        if (is_bg_job_running(j->pid)) {
-            j = j->next;
-            continue;
-        }
-
-        pid_t result = waitpid(j->pid, &status, WNOHANG | WUNTRACED);
-        if (result == 0) {
-            // Still running / nothing to report
-            j = j->next;
-            continue;
-        }
-        if (result > 0) {
-            if (WIFEXITED(status) || WIFSIGNALED(status)) {
-                // Terminated: remove from list
-                pid_t dead = j->pid;
-                j = j->next; // advance before removal
-                removeJob(dead);
-                continue;
-            } else if (WIFSTOPPED(status)) {
-                j->running = 0; // stopped but retained
-            }
-#ifdef WCONTINUED
-            else if (WIFCONTINUED(status)) {
-                j->running = 1; // continued
-            }
-#endif
-        } else { // result < 0
-            if (errno == ECHILD) {
-                // Already reaped elsewhere (e.g., separate bg check); remove stale entry
-                pid_t dead = j->pid;
-                j = j->next;
-                removeJob(dead);
-                continue;
-            }
-        }
-        j = j->next;
-    }
+    uint64_t start = statsNow();
+    reapChildren();
+    statsRecord(STATS_JOBS, start);
 }
 
 int compareJobs(const void *a, const void *b) {
@@ -89,13 +136,9 @@ void printActivities() {
     // First reap any background jobs so we don't show them as Running right
     // after they have actually exited (race between user invoking activities
     // and the periodic check in the main loop).
-    check_bg_jobs();
-    updateJobs(); // refresh states (non-bg jobs or any still present)
+    check_bg_jobs(); // also brings every job's running/stopped state up to date
 
-    // Count jobs
-    int count = 0;
-    struct job *j = job_list;
-    while (j) { count++; j = j->next; }
+    int count = jobCount;
 
     if (count == 0) {
         //printf("No active jobs\n");
@@ -104,7 +147,8 @@ void printActivities() {
 
     // Copy into array
     struct job **arr = malloc(count * sizeof(struct job *));
-    j = job_list;
+    if (!arr) return;
+    struct job *j = job_list;
     for (int i = 0; i < count; i++) {
         arr[i] = j;
         j = j->next;
@@ -0,0 +1,237 @@
+#include "../include/pathcache.h"
+#include "../include/cwd.h"
+#include <stdint.h>
+
+static struct path_cache_entry* buckets[PATH_CACHE_BUCKETS];
+static int entryCount = 0;
+
+static char* cachedPathVar = NULL; // PATH the dirs were parsed from
+static struct path_dir* dirs = NULL;
+static int dirCount = 0;
+static int firstRelative = 0; // index of the first relative dir, dirCount if none
+static bool needsCheck = true;
+static unsigned long checkedGeneration = 0; // cwdGeneration the entries were found under
+
+static char* scratchPath = NULL; // last uncacheable (relative) hit
+
+
+static void dropEntries(int fromDirIndex){
+    for (int b = 0; b < PATH_CACHE_BUCKETS; b++) {
+        struct path_cache_entry** link = &buckets[b];
+        while (*link) {
+            struct path_cache_entry* entry = *link;
+            if (entry->dirIndex >= fromDirIndex) {
+                *link = entry->next;
+                free(entry->name);
+                free(entry->path);
+                free(entry);
+                entryCount--;
+            } else {
+                link = &entry->next;
+            }
+        }
+    }
+}
+
+void pathCacheClear(void){
+    dropEntries(0);
+}
+
+static void statDir(struct path_dir* pathDir){
+    struct stat st;
+    if (pathDir->relative || stat(pathDir->dir, &st) != 0) {
+        pathDir->mtime.tv_sec = 0;
+        pathDir->mtime.tv_nsec = 0;
+        return;
+    }
+    pathDir->mtime = st.st_mtim;
+}
+
+static void freeDirs(void){
+    for (int i = 0; i < dirCount; i++) free(dirs[i].dir);
+    free(dirs);
+    dirs = NULL;
+    dirCount = 0;
+}
+
+// Split PATH into dirs and remember their mtimes; an empty component means the cwd
+static void parsePathVar(const char* pathVar){
+    freeDirs();
+    free(cachedPathVar);
+    cachedPathVar = strdup(pathVar);
+
+    int components = 1;
+    for (const char* c = pathVar; *c; c++) if (*c == ':') components++;
+    dirs = (struct path_dir*)calloc(components, sizeof(struct path_dir));
+    if (dirs == NULL) return;
+
+    const char* start = pathVar;
+    firstRelative = -1;
+    while (1) {
+        const char* end = strchr(start, ':');
+        size_t length = end ? (size_t)(end - start) : strlen(start);
+        struct path_dir* pathDir = &dirs[dirCount++];
+        pathDir->dir = (length == 0) ? strdup(".") : strndup(start, length);
+        pathDir->relative = (pathDir->dir == NULL || pathDir->dir[0] != '/');
+        if (pathDir->relative && firstRelative < 0) firstRelative = dirCount - 1;
+        statDir(pathDir);
+        if (end == NULL) break;
+        start = end + 1;
+    }
+    if (firstRelative < 0) firstRelative = dirCount;
+}
+
+// After a cwd change a relative dir holds other files, which may shadow anything
+// found in the dirs after it
+static void checkCwd(void){
+    if (checkedGeneration == cwdGeneration) return;
+    checkedGeneration = cwdGeneration;
+    if (firstRelative < dirCount) dropEntries(firstRelative + 1);
+}
+
+static void checkPathDirs(void){
+    needsCheck = false;
+    const char* pathVar = getenv("PATH");
+    if (pathVar == NULL) pathVar = "/bin:/usr/bin"; // what execvp searches without PATH
+
+    if (cachedPathVar == NULL || strcmp(pathVar, cachedPathVar) != 0) {
+        pathCacheClear();
+        parsePathVar(pathVar);
+        checkedGeneration = cwdGeneration;
+        return;
+    }
+    if (entryCount == 0) return; // nothing that could be stale
+
+    int firstChanged = dirCount;
+    for (int i = 0; i < dirCount; i++) {
+        struct timespec before = dirs[i].mtime;
+        statDir(&dirs[i]);
+        if ((before.tv_sec != dirs[i].mtime.tv_sec || before.tv_nsec != dirs[i].mtime.tv_nsec)
+            && i < firstChanged) {
+            firstChanged = i;
+        }
+    }
+    if (firstChanged < dirCount) dropEntries(firstChanged);
+}
+
+void pathCacheRevalidate(void){
+    needsCheck = true;
+}
+
+
+// 32-bit FNV-1a
+static uint32_t nameHash(const char* name){
+    uint32_t hash = 2166136261u;
+    for (; *name; name++) hash = (hash ^ (unsigned char)*name) * 16777619u;
+    return hash;
+}
+
+static struct path_cache_entry* findEntry(const char* name){
+    uint32_t hash = nameHash(name);
+    struct path_cache_entry* entry = buckets[hash & (PATH_CACHE_BUCKETS - 1)];
+    while (entry && strcmp(entry->name, name) != 0) entry = entry->next;
+    return entry;
+}
+
+static struct path_cache_entry* addEntry(const char* name, char* path, int dirIndex){
+    struct path_cache_entry* entry = (struct path_cache_entry*)malloc(sizeof(struct path_cache_entry));
+    if (entry == NULL) return NULL;
+    entry->name = strdup(name);
+    if (entry->name == NULL) {
+        free(entry);
+        return NULL;
+    }
+    entry->path = path;
+    entry->dirIndex = dirIndex;
+    entry->hits = 0;
+    uint32_t hash = nameHash(name);
+    struct path_cache_entry** bucket = &buckets[hash & (PATH_CACHE_BUCKETS - 1)];
+    entry->next = *bucket;
+    *bucket = entry;
+    entryCount++;
+    return entry;
+}
+
+// What execvp would accept: a regular file we may execute
+static bool isExecutableFile(const char* path){
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISREG(st.st_mode) && access(path, X_OK) == 0;
+}
+
+static const char* lookupPath(const char* name, bool countHit){
+    if (name == NULL || name[0] == '\0') return NULL;
+    if (strchr(name, '/')) return name;
+    if (needsCheck) checkPathDirs();
+    checkCwd(); // every lookup: hop and the command may share a line
+
+    struct path_cache_entry* entry = findEntry(name);
+    if (entry) {
+        if (countHit) entry->hits++;
+        return entry->path;
+    }
+
+    size_t nameLength = strlen(name);
+    for (int i = 0; i < dirCount; i++) {
+        if (dirs[i].dir == NULL) continue;
+        size_t dirLength = strlen(dirs[i].dir);
+        char* candidate = (char*)malloc(dirLength + nameLength + 2);
+        if (candidate == NULL) return NULL;
+        memcpy(candidate, dirs[i].dir, dirLength);
+        candidate[dirLength] = '/';
+        memcpy(candidate + dirLength + 1, name, nameLength + 1);
+
+        if (!isExecutableFile(candidate)) {
+            free(candidate);
+            continue;
+        }
+        if (dirs[i].relative) {
+            free(scratchPath);
+            scratchPath = candidate;
+            return candidate;
+        }
+        entry = addEntry(name, candidate, i);
+        if (entry == NULL) {
+            free(scratchPath);
+            scratchPath = candidate;
+            return candidate;
+        }
+        if (countHit) entry->hits++;
+        return entry->path;
+    }
+    return NULL;
+}
+
+const char* resolveCommand(const char* name){
+    return lookupPath(name, true);
+}
+
+
+void executeHash(int argc, char** argv){
+    if (argc == 2 && strcmp(argv[1], "-r") == 0) {
+        pathCacheClear();
+        return;
+    }
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++) {
+            if (argv[i][0] == '-') {
+                fprintf(stderr, "Invalid syntax!\n");
+                return;
+            }
+            if (lookupPath(argv[i], false) == NULL) fprintf(stderr, "hash: %s: not found\n", argv[i]);
+        }
+        return;
+    }
+
+    if (needsCheck) checkPathDirs(); // do not list entries that are already stale
+    checkCwd();
+    if (entryCount == 0) {
+        printf("hash: hash table empty\n");
+        return;
+    }
+    printf("hits\tcommand\n");
+    for (int b = 0; b < PATH_CACHE_BUCKETS; b++) {
+        for (struct path_cache_entry* entry = buckets[b]; entry; entry = entry->next) {
+            printf("%4lu\t%s\n", entry->hits, entry->path);
+        }
+    }
+}
\ No newline at end of file
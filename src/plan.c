@@ -0,0 +1,140 @@
+#include "../include/plan.h"
+#include <stdint.h>
+#include <unistd.h>
+
+static const struct{
+    const char* name;
+    enum builtin_id id;
+} builtinTable[] = {
+    { "hop", BUILTIN_HOP },
+    { "reveal", BUILTIN_REVEAL },
+    { "log", BUILTIN_LOG },
+    { "activities", BUILTIN_ACTIVITIES },
+    { "ping", BUILTIN_PING },
+    { "fg", BUILTIN_FG },
+    { "bg", BUILTIN_BG },
+    { "exit", BUILTIN_EXIT },
+    { "cache", BUILTIN_CACHE },
+    { "launch", BUILTIN_LAUNCH },
+    { "hash", BUILTIN_HASH },
+    { "each", BUILTIN_EACH },
+    { "time", BUILTIN_TIME },
+    { "timing", BUILTIN_TIMING },
+    { "stats", BUILTIN_STATS },
+};
+
+enum builtin_id lookupBuiltin(const char* name){
+    for (size_t i = 0; i < sizeof(builtinTable) / sizeof(builtinTable[0]); i++) {
+        if (strcmp(name, builtinTable[i].name) == 0) return builtinTable[i].id;
+    }
+    return BUILTIN_NONE;
+}
+
+
+// Where the string pointers of the tree land once its line buffers are copied into the blob
+struct lineCopy{
+    const struct shell_cmd* tree;
+    char* source;
+    char* argBuffer;
+};
+
+static char* rebase(const struct lineCopy* copy, char* ptr){
+    uintptr_t p = (uintptr_t)ptr;
+    uintptr_t source = (uintptr_t)copy->tree->source;
+    uintptr_t args = (uintptr_t)copy->tree->argBuffer;
+    if (p >= source && p <= source + copy->tree->lineLength) return copy->source + (p - source);
+    if (p >= args && p <= args + copy->tree->lineLength) return copy->argBuffer + (p - args);
+    return ptr;
+}
+
+// Redirections are "<sep> <first word of the next terminal>"; a terminal with no words is skipped
+static int countRedirs(const struct atomic* atomic){
+    int count = 0;
+    for (int i = 0; i < atomic->sepArrIndex - 1; i++) {
+        if (atomic->terminalArr[i + 1]->cmdAndArgsIndex > 0) count++;
+    }
+    return count;
+}
+
+
+struct plan* compilePlan(const struct shell_cmd* shellCommand){
+    if (shellCommand == NULL || !shellCommand->validity || shellCommand->source == NULL) return NULL;
+
+    // Pass 1: size the blob
+    int nodeCount = 0;
+    int redirCount = 0;
+    int argvSlots = 0;
+    for (int i = 0; i < shellCommand->cmdArrIndex; i++) {
+        const struct cmd_group* group = shellCommand->cmdGroupArr[i];
+        nodeCount += 1 + group->atomicArrIndex;
+        for (int j = 0; j < group->atomicArrIndex; j++) {
+            const struct atomic* atomic = group->atomicArr[j];
+            int argc = (atomic->termArrIndex > 0) ? atomic->terminalArr[0]->cmdAndArgsIndex : 0;
+            argvSlots += argc + 1;
+            redirCount += countRedirs(atomic);
+        }
+    }
+    size_t lineBytes = (size_t)shellCommand->lineLength + 1;
+    size_t size = sizeof(struct plan) + nodeCount * sizeof(struct plan_node)
+                + redirCount * sizeof(struct redir) + argvSlots * sizeof(char*) + 2 * lineBytes;
+
+    struct plan* plan = (struct plan*)malloc(size);
+    if (plan == NULL) {
+        perror("malloc failed");
+        return NULL;
+    }
+    plan->size = size;
+    plan->nodeCount = nodeCount;
+
+    struct redir* redirs = (struct redir*)(plan->nodes + nodeCount);
+    char** argvs = (char**)(redirs + redirCount);
+    struct lineCopy copy = { shellCommand, (char*)(argvs + argvSlots), NULL };
+    copy.argBuffer = copy.source + lineBytes;
+    memcpy(copy.source, shellCommand->source, lineBytes);
+    memcpy(copy.argBuffer, shellCommand->argBuffer, lineBytes);
+
+    // Pass 2: fill the nodes in execution order
+    struct plan_node* node = plan->nodes;
+    for (int i = 0; i < shellCommand->cmdArrIndex; i++) {
+        const struct cmd_group* group = shellCommand->cmdGroupArr[i];
+        const char* sep = (i < shellCommand->sepArrIndex) ? shellCommand->separatorArr[i] : "";
+
+        memset(node, 0, sizeof(struct plan_node));
+        node->op = (sep[0] != '&') ? OP_GROUP : (sep[1] == '&') ? OP_GROUP_PAR : OP_GROUP_BG;
+        node->stageCount = group->atomicArrIndex;
+        node->text = rebase(&copy, group->cmdString);
+        node->textLength = group->cmdLength;
+        node++;
+
+        for (int j = 0; j < group->atomicArrIndex; j++) {
+            const struct atomic* atomic = group->atomicArr[j];
+            const struct terminal* first = (atomic->termArrIndex > 0) ? atomic->terminalArr[0] : NULL;
+
+            memset(node, 0, sizeof(struct plan_node));
+            node->op = OP_STAGE;
+            node->text = rebase(&copy, atomic->atomicString);
+            node->textLength = atomic->atomicLength;
+
+            node->argc = first ? first->cmdAndArgsIndex : 0;
+            node->argv = argvs;
+            for (int k = 0; k < node->argc; k++) argvs[k] = rebase(&copy, first->cmdAndArgs[k]);
+            argvs[node->argc] = NULL;
+            argvs += node->argc + 1;
+            node->builtin = (node->argc > 0) ? lookupBuiltin(node->argv[0]) : BUILTIN_NONE;
+
+            node->redirs = redirs;
+            for (int k = 0; k < atomic->sepArrIndex - 1; k++) {
+                const struct terminal* target = atomic->terminalArr[k + 1];
+                if (target->cmdAndArgsIndex == 0) continue;
+                const char* op = atomic->separatorArr[k];
+                redirs->mode = (op[0] == '<') ? REDIR_READ : (op[1] == '>') ? REDIR_APPEND : REDIR_WRITE;
+                redirs->target_fd = (op[0] == '<') ? STDIN_FILENO : STDOUT_FILENO;
+                redirs->filename = rebase(&copy, target->cmdAndArgs[0]);
+                redirs++;
+                node->redirCount++;
+            }
+            node++;
+        }
+    }
+    return plan;
+}
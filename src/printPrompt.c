@@ -1,4 +1,8 @@
 #include "../include/printPrompt.h"
+#include "../include/cwd.h"
+
+static char* cachedPrompt = NULL;
+static unsigned long cachedGeneration = 0;
 
 bool isSubstring(char* absPath, char* currPath){
     // Check lengths. If absPath is longer, currPath cannot be a substring
@@ -40,4 +44,25 @@ char* getPathToPrint(char* absPath, char* currPath){
     }
 }
 
-// LLM ENDS
\ No newline at end of file
+// LLM ENDS
+
+const char* getPrompt(const char* username, const char* hostname, char* absPath){
+    // Only rebuilt after hop has actually moved
+    if (cachedPrompt != NULL && cachedGeneration == cwdGeneration) return cachedPrompt;
+
+    char* pathToPrint = getPathToPrint(absPath, currentWD);
+    if (pathToPrint == NULL) return cachedPrompt ? cachedPrompt : "> ";
+    size_t length = strlen(username) + strlen(hostname) + strlen(pathToPrint) + 6; // "<@:> " and '\0'
+    char* prompt = (char*)malloc(length);
+    if (prompt == NULL) {
+        perror("malloc failed");
+        free(pathToPrint);
+        return cachedPrompt ? cachedPrompt : "> ";
+    }
+    snprintf(prompt, length, "<%s@%s:%s> ", username, hostname, pathToPrint);
+    free(pathToPrint);
+    free(cachedPrompt);
+    cachedPrompt = prompt;
+    cachedGeneration = cwdGeneration;
+    return cachedPrompt;
+}
\ No newline at end of file
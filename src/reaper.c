@@ -0,0 +1,151 @@
+#define _DEFAULT_SOURCE // wait4()
+#include "../include/reaper.h"
+#include "../include/executes.h"
+#include <errno.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/signalfd.h>
+#include <sys/epoll.h>
+
+static int sigFd = -1;
+static int epollFd = -1;
+
+// Foreground pids reaperWaitPids is blocked on
+static const pid_t* fgPids = NULL;
+static int* fgStatuses = NULL;
+static struct stage_usage* fgUsages = NULL;
+static int fgCount = 0;
+static int fgRemaining = 0;
+
+
+void reaperInit(void){
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    if (sigprocmask(SIG_BLOCK, &mask, NULL) != 0) return;
+
+    sigFd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event event = { .events = EPOLLIN, .data.fd = sigFd };
+    if (sigFd < 0 || epollFd < 0 || epoll_ctl(epollFd, EPOLL_CTL_ADD, sigFd, &event) != 0) {
+        perror("reaper setup failed");
+        reaperChildInit(); // plain blocking waitpid from now on
+    }
+}
+
+void reaperChildInit(void){
+    if (sigFd >= 0) close(sigFd);
+    if (epollFd >= 0) close(epollFd);
+    sigFd = -1;
+    epollFd = -1;
+    fgPids = NULL;
+    fgUsages = NULL;
+    fgCount = fgRemaining = 0;
+
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigprocmask(SIG_UNBLOCK, &mask, NULL);
+}
+
+
+static void dispatch(pid_t pid, int status, const struct rusage* ru){
+    for (int i = 0; i < fgCount; i++) {
+        if (fgPids[i] != pid) continue;
+        if (WIFCONTINUED(status)) return;
+        fgStatuses[i] = status;
+        if (fgUsages != NULL && WIFSTOPPED(status)) fgUsages[i].stopped = true;
+        else if (fgUsages != NULL) usageFinish(&fgUsages[i], ru);
+        fgRemaining--;
+        return;
+    }
+    jobStatusChanged(pid, status);
+}
+
+// One non-blocking pass; false once there are no children left at all
+static bool reapPass(void){
+    if (sigFd >= 0) {
+        // waitpid(-1) walks every child in the kernel, so only call it after a SIGCHLD.
+        // Any change after this drain leaves a new signal behind for the next pass.
+        struct signalfd_siginfo info[8];
+        bool signalled = false;
+        while (read(sigFd, info, sizeof(info)) > 0) signalled = true;
+        if (!signalled) return true;
+    }
+    int status;
+    struct rusage ru;
+    pid_t pid;
+    while ((pid = wait4(-1, &status, WNOHANG | WUNTRACED | WCONTINUED, &ru)) > 0) dispatch(pid, status, &ru);
+    return !(pid < 0 && errno == ECHILD);
+}
+
+void reapChildren(void){
+    reapPass();
+}
+
+
+void reaperWaitPids(const pid_t* pids, int count, int* statuses){
+    reaperWaitPidsUsage(pids, count, statuses, NULL);
+}
+
+void reaperWaitPidsUsage(const pid_t* pids, int count, int* statuses, struct stage_usage* usages){
+    fgPids = pids;
+    fgStatuses = statuses;
+    fgUsages = usages;
+    fgCount = count;
+    fgRemaining = 0;
+    for (int i = 0; i < count; i++) {
+        statuses[i] = 0;
+        if (pids[i] > 0) fgRemaining++;
+    }
+
+    while (fgRemaining > 0) {
+        if (sigFd >= 0) {
+            if (!reapPass() || fgRemaining == 0) break;
+            struct epoll_event event;
+            if (epoll_wait(epollFd, &event, 1, -1) < 0 && errno != EINTR) break;
+        } else {
+            int status;
+            struct rusage ru;
+            pid_t pid = wait4(-1, &status, WUNTRACED, &ru);
+            if (pid < 0) {
+                if (errno == EINTR) continue;
+                break; // ECHILD: nothing left to wait for
+            }
+            dispatch(pid, status, &ru);
+        }
+    }
+
+    fgPids = NULL;
+    fgStatuses = NULL;
+    fgUsages = NULL;
+    fgCount = fgRemaining = 0;
+}
+
+
+bool waitForInput(int fd){
+    if (sigFd < 0) return true;
+    struct epoll_event event = { .events = EPOLLIN, .data.fd = fd };
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0) return true;
+
+    bool inputReady = false;
+    while (!inputReady) {
+        reapPass();
+        if (jobNotificationsPending()) break;
+
+        struct epoll_event events[2];
+        // Idle at the prompt: wake up for the periodic stats export too
+        int ready = epoll_wait(epollFd, events, 2, statsTickTimeout());
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            inputReady = true; // let the caller's read report the problem
+        }
+        if (ready == 0) statsTick();
+        for (int i = 0; i < ready; i++) {
+            if (events[i].data.fd == fd) inputReady = true;
+        }
+    }
+
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, NULL);
+    return inputReady;
+}
\ No newline at end of file
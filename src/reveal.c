@@ -0,0 +1,189 @@
+#define _GNU_SOURCE // syscall()
+#include "../include/reveal.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+// Record layout returned by getdents64
+struct linux_dirent64{
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+
+static bool addEntry(struct reveal_listing* listing, const char* name, unsigned char type){
+    if (listing->count == listing->capacity) {
+        size_t newCapacity = listing->capacity ? listing->capacity * 2 : 256;
+        struct reveal_entry* grown = (struct reveal_entry*)realloc(listing->entries, newCapacity * sizeof(struct reveal_entry));
+        if (grown == NULL) {
+            perror("realloc failed");
+            return false;
+        }
+        listing->entries = grown;
+        listing->capacity = newCapacity;
+    }
+    listing->entries[listing->count].name = name;
+    listing->entries[listing->count].type = type;
+    listing->count++;
+    return true;
+}
+
+bool revealCollect(struct reveal_listing* listing, const char* dirPath, bool all){
+    memset(listing, 0, sizeof(struct reveal_listing));
+    int fd = open(dirPath, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return false;
+    arenaInit(&listing->arena, REVEAL_DENTS_FIRST_BATCH);
+
+    bool ok = true;
+    char* batch = NULL;
+    size_t batchSize = 0;
+    size_t batchUsed = 0; // bytes holding records that entries point into
+    while (ok) {
+        if (batchSize - batchUsed < REVEAL_DENTS_MIN_TAIL) {
+            size_t grownSize = (batchSize == 0) ? REVEAL_DENTS_FIRST_BATCH : batchSize * 2;
+            if (grownSize > REVEAL_DENTS_BATCH) grownSize = REVEAL_DENTS_BATCH;
+            batch = (char*)arenaAlloc(&listing->arena, grownSize);
+            if (batch == NULL) {
+                perror("malloc failed");
+                ok = false;
+                break;
+            }
+            batchSize = grownSize;
+            batchUsed = 0;
+        }
+        char* tail = batch + batchUsed;
+        long got = syscall(SYS_getdents64, fd, tail, batchSize - batchUsed);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) {
+            ok = (got == 0);
+            break;
+        }
+        bool kept = false;
+        for (long offset = 0; offset < got && ok; ) {
+            struct linux_dirent64* record = (struct linux_dirent64*)(tail + offset);
+            offset += record->d_reclen;
+            // Skip hidden files unless -a flag is set
+            if (!all && record->d_name[0] == '.') continue;
+            ok = addEntry(listing, record->d_name, record->d_type);
+            kept = true;
+        }
+        // A read with no kept entries leaves the tail free to be read into again
+        if (kept) batchUsed += ((size_t)got + 7) & ~(size_t)7;
+    }
+    close(fd);
+
+    if (!ok) revealFree(listing);
+    return ok;
+}
+
+
+static void swapEntries(struct reveal_entry* a, struct reveal_entry* b){
+    struct reveal_entry temp = *a;
+    *a = *b;
+    *b = temp;
+}
+
+// Up to 8 bytes of s as a big-endian word, zero-filled after the terminator:
+// comparing two keys as integers orders them exactly as strcmp would
+static uint64_t loadKey(const char* s){
+    uint64_t key = 0;
+    for (int i = 0; i < 8; i++) {
+        unsigned char c = (unsigned char)s[i];
+        key = key << 8 | c;
+        if (c == 0) return key << (8 * (7 - i));
+    }
+    return key;
+}
+
+static void loadKeys(struct reveal_entry* entries, size_t count, size_t depth){
+    for (size_t i = 0; i < count; i++) entries[i].key = loadKey(entries[i].name + depth);
+}
+
+// Both keys were loaded at depth
+static int compareFrom(const struct reveal_entry* a, const struct reveal_entry* b, size_t depth){
+    if (a->key != b->key) return (a->key < b->key) ? -1 : 1;
+    if ((a->key & 0xff) == 0) return 0; // both ended inside this word
+    return strcmp(a->name + depth + 8, b->name + depth + 8);
+}
+
+static void insertionSort(struct reveal_entry* entries, size_t count, size_t depth){
+    for (size_t i = 1; i < count; i++) {
+        for (size_t j = i; j > 0 && compareFrom(&entries[j - 1], &entries[j], depth) > 0; j--) {
+            swapEntries(&entries[j - 1], &entries[j]);
+        }
+    }
+}
+
+static uint64_t medianOfThree(uint64_t a, uint64_t b, uint64_t c){
+    if (a < b) return (b < c) ? b : (a < c) ? c : a;
+    return (a < c) ? a : (b < c) ? c : b;
+}
+
+// Bentley-Sedgewick multikey quicksort, eight bytes per level: three-way partition on
+// the cached key, recurse on < and >, and continue eight bytes deeper on =. The keys
+// live in the entries, so partitioning streams through the array instead of chasing
+// a name pointer per comparison.
+static void multikeySort(struct reveal_entry* entries, size_t count, size_t depth){
+    while (count > REVEAL_INSERTION_CUTOFF) {
+        uint64_t pivot = medianOfThree(entries[0].key, entries[count / 2].key, entries[count - 1].key);
+        size_t lt = 0, i = 0, gt = count;
+        struct reveal_entry temp;
+        while (i < gt) {
+            uint64_t key = entries[i].key;
+            // Swaps spelled out: this loop is most of the sort
+            if (key < pivot) {
+                temp = entries[lt]; entries[lt] = entries[i]; entries[i] = temp;
+                lt++;
+                i++;
+            } else if (key > pivot) {
+                gt--;
+                temp = entries[gt]; entries[gt] = entries[i]; entries[i] = temp;
+            } else {
+                i++;
+            }
+        }
+        multikeySort(entries, lt, depth);
+        multikeySort(entries + gt, count - gt, depth);
+        if ((pivot & 0xff) == 0) return; // the = part is identical strings
+        entries += lt;
+        count = gt - lt;
+        depth += 8;
+        loadKeys(entries, count, depth);
+    }
+    insertionSort(entries, count, depth);
+}
+
+void revealSort(struct reveal_entry* entries, size_t count){
+    loadKeys(entries, count, 0);
+    multikeySort(entries, count, 0);
+}
+
+
+void revealFormat(struct out_buffer* out, const struct reveal_listing* listing, bool lines){
+    const char* separator = lines ? "\n" : "  ";
+    size_t separatorLength = strlen(separator);
+    for (size_t i = 0; i < listing->count; i++) {
+        outString(out, listing->entries[i].name);
+        outWrite(out, separator, separatorLength);
+    }
+    if (!lines) outWrite(out, "\n", 1);
+}
+
+void revealPrint(const struct reveal_listing* listing, bool lines){
+    struct out_buffer out;
+    if (!outInit(&out, STDOUT_FILENO)) return;
+    revealFormat(&out, listing, lines);
+    outFree(&out);
+}
+
+void revealFree(struct reveal_listing* listing){
+    arenaDestroy(&listing->arena);
+    free(listing->entries);
+    listing->entries = NULL;
+    listing->count = listing->capacity = 0;
+}
\ No newline at end of file
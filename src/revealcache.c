@@ -0,0 +1,102 @@
+#include "../include/revealcache.h"
+#include <time.h>
+
+struct reveal_cache_stats revealCacheStats = {0};
+
+static struct reveal_cache_entry* lruHead = NULL; // most recently used
+static struct reveal_cache_entry* lruTail = NULL; // next to be evicted
+
+
+static void lruUnlink(struct reveal_cache_entry* entry){
+    if (entry->lruPrev) entry->lruPrev->lruNext = entry->lruNext; else lruHead = entry->lruNext;
+    if (entry->lruNext) entry->lruNext->lruPrev = entry->lruPrev; else lruTail = entry->lruPrev;
+    entry->lruPrev = NULL;
+    entry->lruNext = NULL;
+}
+
+static void lruPushFront(struct reveal_cache_entry* entry){
+    entry->lruPrev = NULL;
+    entry->lruNext = lruHead;
+    if (lruHead) lruHead->lruPrev = entry; else lruTail = entry;
+    lruHead = entry;
+}
+
+static void dropEntry(struct reveal_cache_entry* entry){
+    lruUnlink(entry);
+    revealCacheStats.entries--;
+    revealCacheStats.bytes -= entry->bytes;
+    free(entry->entries);
+    free(entry);
+}
+
+static bool sameTime(const struct timespec* a, const struct timespec* b){
+    return a->tv_sec == b->tv_sec && a->tv_nsec == b->tv_nsec;
+}
+
+
+const struct reveal_entry* revealCacheLookup(const struct stat* st, bool all, size_t* count){
+    // At most REVEAL_CACHE_CAPACITY entries: a scan of the LRU list is enough
+    for (struct reveal_cache_entry* entry = lruHead; entry != NULL; entry = entry->lruNext) {
+        if (entry->ino != st->st_ino || entry->dev != st->st_dev || entry->all != all) continue;
+        if (!sameTime(&entry->mtime, &st->st_mtim) || !sameTime(&entry->ctime, &st->st_ctim)) {
+            dropEntry(entry);
+            revealCacheStats.invalidations++;
+            break;
+        }
+        lruUnlink(entry);
+        lruPushFront(entry);
+        revealCacheStats.hits++;
+        *count = entry->count;
+        return entry->entries;
+    }
+    revealCacheStats.misses++;
+    return NULL;
+}
+
+void revealCacheInsert(const struct stat* st, bool all, const struct reveal_listing* listing){
+    time_t now = time(NULL);
+    if (now - st->st_mtim.tv_sec < REVEAL_CACHE_RACY_SECONDS || now - st->st_ctim.tv_sec < REVEAL_CACHE_RACY_SECONDS) return;
+
+    // Compact copy: the listing's own arena holds whole getdents64 batches
+    size_t bytes = listing->count * sizeof(struct reveal_entry);
+    for (size_t i = 0; i < listing->count; i++) bytes += strlen(listing->entries[i].name) + 1;
+    if (bytes > REVEAL_CACHE_MAX_BYTES / 2) return;
+
+    while (lruTail != NULL && (revealCacheStats.entries >= REVEAL_CACHE_CAPACITY
+                               || revealCacheStats.bytes + bytes > REVEAL_CACHE_MAX_BYTES)) {
+        dropEntry(lruTail);
+        revealCacheStats.evictions++;
+    }
+
+    struct reveal_cache_entry* entry = (struct reveal_cache_entry*)calloc(1, sizeof(struct reveal_cache_entry));
+    struct reveal_entry* entries = (struct reveal_entry*)malloc(bytes ? bytes : 1);
+    if (entry == NULL || entries == NULL) {
+        free(entry);
+        free(entries);
+        return;
+    }
+    char* names = (char*)(entries + listing->count);
+    for (size_t i = 0; i < listing->count; i++) {
+        size_t length = strlen(listing->entries[i].name) + 1;
+        memcpy(names, listing->entries[i].name, length);
+        entries[i] = listing->entries[i];
+        entries[i].name = names;
+        names += length;
+    }
+
+    entry->dev = st->st_dev;
+    entry->ino = st->st_ino;
+    entry->all = all;
+    entry->mtime = st->st_mtim;
+    entry->ctime = st->st_ctim;
+    entry->entries = entries;
+    entry->count = listing->count;
+    entry->bytes = bytes + sizeof(struct reveal_cache_entry);
+    lruPushFront(entry);
+    revealCacheStats.entries++;
+    revealCacheStats.bytes += entry->bytes;
+}
+
+void revealCacheClear(void){
+    while (lruHead != NULL) dropEntry(lruHead);
+}
\ No newline at end of file
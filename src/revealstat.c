@@ -0,0 +1,264 @@
+#define _GNU_SOURCE // statx()
+#include "../include/reveal.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <pwd.h>
+#include <grp.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+#define REVEAL_STATX_MASK (STATX_TYPE | STATX_MODE | STATX_NLINK | STATX_UID | STATX_GID | STATX_SIZE | STATX_MTIME | STATX_BLOCKS)
+
+struct stat_job{
+    int dirFd;
+    const struct reveal_entry* entries;
+    struct reveal_stat* stats;
+    size_t count;
+    size_t next; // next unclaimed entry, advanced atomically
+};
+
+
+static void statEntry(int dirFd, const char* name, struct reveal_stat* out){
+    struct statx stx;
+    if (statx(dirFd, name, AT_SYMLINK_NOFOLLOW, REVEAL_STATX_MASK, &stx) == 0) {
+        out->mode = stx.stx_mode;
+        out->nlink = stx.stx_nlink;
+        out->uid = stx.stx_uid;
+        out->gid = stx.stx_gid;
+        out->size = (off_t)stx.stx_size;
+        out->blocks = stx.stx_blocks;
+        out->mtime = (time_t)stx.stx_mtime.tv_sec;
+        out->rdevMajor = stx.stx_rdev_major;
+        out->rdevMinor = stx.stx_rdev_minor;
+    } else {
+        // Kernels without statx
+        struct stat st;
+        if (errno != ENOSYS || fstatat(dirFd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) return;
+        out->mode = st.st_mode;
+        out->nlink = st.st_nlink;
+        out->uid = st.st_uid;
+        out->gid = st.st_gid;
+        out->size = st.st_size;
+        out->blocks = (uint64_t)st.st_blocks;
+        out->mtime = st.st_mtime;
+        out->rdevMajor = major(st.st_rdev);
+        out->rdevMinor = minor(st.st_rdev);
+    }
+    out->valid = true;
+
+    if (S_ISLNK(out->mode)) {
+        char target[4096];
+        ssize_t length = readlinkat(dirFd, name, target, sizeof(target) - 1);
+        if (length >= 0) out->linkTarget = strndup(target, (size_t)length);
+    }
+}
+
+static void* statWorker(void* arg){
+    struct stat_job* job = (struct stat_job*)arg;
+    while (1) {
+        size_t from = __atomic_fetch_add(&job->next, REVEAL_STAT_CHUNK, __ATOMIC_RELAXED);
+        if (from >= job->count) break;
+        size_t to = (from + REVEAL_STAT_CHUNK < job->count) ? from + REVEAL_STAT_CHUNK : job->count;
+        for (size_t i = from; i < to; i++) statEntry(job->dirFd, job->entries[i].name, &job->stats[i]);
+    }
+    return NULL;
+}
+
+// statx every entry; big listings are spread over REVEAL_STAT_THREADS workers so that
+// slow (network, cold cache) lookups overlap. Workers are joined before returning.
+static void statAll(struct stat_job* job, bool parallel){
+    size_t threadCount = 0;
+    pthread_t threads[REVEAL_STAT_THREADS];
+    if (parallel && job->count >= REVEAL_STAT_PARALLEL_MIN) {
+        size_t wanted = job->count / REVEAL_STAT_CHUNK;
+        if (wanted > REVEAL_STAT_THREADS) wanted = REVEAL_STAT_THREADS;
+        while (threadCount + 1 < wanted && pthread_create(&threads[threadCount], NULL, statWorker, job) == 0) {
+            threadCount++;
+        }
+    }
+    statWorker(job); // this thread works too, and finishes the job alone if no worker started
+    for (size_t i = 0; i < threadCount; i++) pthread_join(threads[i], NULL);
+}
+
+
+// uid/gid -> name, looked up once per id
+struct id_name{
+    unsigned int id;
+    char* name;
+};
+
+struct id_names{
+    struct id_name* items;
+    size_t count;
+    size_t capacity;
+};
+
+static const char* idName(struct id_names* names, unsigned int id, bool group){
+    for (size_t i = 0; i < names->count; i++) {
+        if (names->items[i].id == id) return names->items[i].name;
+    }
+    // The _r variants: reveal -R formats listings on several threads at once
+    char buffer[4096];
+    const char* name = NULL;
+    if (group) {
+        struct group gr, *found = NULL;
+        if (getgrgid_r(id, &gr, buffer, sizeof(buffer), &found) == 0 && found != NULL) name = gr.gr_name;
+    } else {
+        struct passwd pw, *found = NULL;
+        if (getpwuid_r(id, &pw, buffer, sizeof(buffer), &found) == 0 && found != NULL) name = pw.pw_name;
+    }
+    if (name == NULL) {
+        snprintf(buffer, sizeof(buffer), "%u", id);
+        name = buffer;
+    }
+
+    if (names->count == names->capacity) {
+        size_t newCapacity = names->capacity ? names->capacity * 2 : 8;
+        struct id_name* grown = (struct id_name*)realloc(names->items, newCapacity * sizeof(struct id_name));
+        if (grown == NULL) return "?";
+        names->items = grown;
+        names->capacity = newCapacity;
+    }
+    char* copy = strdup(name);
+    if (copy == NULL) return "?";
+    names->items[names->count].id = id;
+    names->items[names->count].name = copy;
+    return names->items[names->count++].name;
+}
+
+static void freeIdNames(struct id_names* names){
+    for (size_t i = 0; i < names->count; i++) free(names->items[i].name);
+    free(names->items);
+}
+
+static void formatMode(mode_t mode, char* out){
+    out[0] = S_ISDIR(mode) ? 'd' : S_ISLNK(mode) ? 'l' : S_ISCHR(mode) ? 'c' : S_ISBLK(mode) ? 'b'
+           : S_ISFIFO(mode) ? 'p' : S_ISSOCK(mode) ? 's' : '-';
+    const char* rwx = "rwxrwxrwx";
+    for (int i = 0; i < 9; i++) out[i + 1] = (mode & (1 << (8 - i))) ? rwx[i] : '-';
+    if (mode & S_ISUID) out[3] = (mode & S_IXUSR) ? 's' : 'S';
+    if (mode & S_ISGID) out[6] = (mode & S_IXGRP) ? 's' : 'S';
+    if (mode & S_ISVTX) out[9] = (mode & S_IXOTH) ? 't' : 'T';
+    out[10] = '\0';
+}
+
+static int digits(unsigned long long value){
+    int count = 1;
+    while (value >= 10) {
+        value /= 10;
+        count++;
+    }
+    return count;
+}
+
+// ls -l layout: columns padded to the widest value in the listing, and the
+// year instead of the time for anything older than six months or in the future
+void revealFormatLong(struct out_buffer* out, int dirFd, const struct reveal_entry* entries, size_t count,
+                      bool total, bool parallel){
+    struct reveal_stat* stats = (struct reveal_stat*)calloc(count ? count : 1, sizeof(struct reveal_stat));
+    if (stats == NULL) {
+        perror("calloc failed");
+        return;
+    }
+    struct stat_job job = { dirFd, entries, stats, count, 0 };
+    statAll(&job, parallel);
+
+    struct id_names users = { NULL, 0, 0 }, groups = { NULL, 0, 0 };
+    int linkWidth = 1, userWidth = 1, groupWidth = 1, sizeWidth = 1, majorWidth = 0, minorWidth = 0;
+    unsigned long long totalBlocks = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (!stats[i].valid) continue;
+        int width;
+        if ((width = digits(stats[i].nlink)) > linkWidth) linkWidth = width;
+        if (S_ISCHR(stats[i].mode) || S_ISBLK(stats[i].mode)) {
+            // Devices show "major, minor" in the size column
+            if ((width = digits(stats[i].rdevMajor)) > majorWidth) majorWidth = width;
+            if ((width = digits(stats[i].rdevMinor)) > minorWidth) minorWidth = width;
+        } else if ((width = digits((unsigned long long)stats[i].size)) > sizeWidth) {
+            sizeWidth = width;
+        }
+        if ((width = (int)strlen(idName(&users, stats[i].uid, false))) > userWidth) userWidth = width;
+        if ((width = (int)strlen(idName(&groups, stats[i].gid, true))) > groupWidth) groupWidth = width;
+        totalBlocks += stats[i].blocks;
+    }
+    if (majorWidth > 0 && majorWidth + 2 + minorWidth > sizeWidth) sizeWidth = majorWidth + 2 + minorWidth;
+    if (majorWidth > 0) majorWidth = sizeWidth - 2 - minorWidth;
+
+    char line[8192];
+    int length;
+    if (total) {
+        length = snprintf(line, sizeof(line), "total %llu\n", totalBlocks / 2); // 1K blocks, as ls
+        outWrite(out, line, (size_t)length);
+    }
+
+    time_t now = time(NULL);
+    time_t cachedMinute = -1;
+    bool cachedRecent = false;
+    char when[32] = "";
+    for (size_t i = 0; i < count; i++) {
+        const struct reveal_stat* st = &stats[i];
+        if (!st->valid) {
+            length = snprintf(line, sizeof(line), "?????????? %*s %-*s %-*s %*s ???????????? %s\n",
+                              linkWidth, "?", userWidth, "?", groupWidth, "?", sizeWidth, "?", entries[i].name);
+            outWrite(out, line, (size_t)length);
+            continue;
+        }
+        char mode[11];
+        formatMode(st->mode, mode);
+
+        // Neighbouring entries usually share a minute; format it once
+        bool recent = st->mtime <= now && now - st->mtime < 6L * 30 * 24 * 3600;
+        if (st->mtime / 60 != cachedMinute || recent != cachedRecent) {
+            struct tm tm;
+            localtime_r(&st->mtime, &tm);
+            strftime(when, sizeof(when), recent ? "%b %e %H:%M" : "%b %e  %Y", &tm);
+            cachedMinute = st->mtime / 60;
+            cachedRecent = recent;
+        }
+
+        char size[48];
+        if (S_ISCHR(st->mode) || S_ISBLK(st->mode)) {
+            snprintf(size, sizeof(size), "%*u, %*u", majorWidth, st->rdevMajor, minorWidth, st->rdevMinor);
+        } else {
+            snprintf(size, sizeof(size), "%*lld", sizeWidth, (long long)st->size);
+        }
+
+        length = snprintf(line, sizeof(line), "%s %*lu %-*s %-*s %s %s %s%s%s\n",
+                          mode, linkWidth, (unsigned long)st->nlink,
+                          userWidth, idName(&users, st->uid, false), groupWidth, idName(&groups, st->gid, true),
+                          size, when, entries[i].name,
+                          st->linkTarget ? " -> " : "", st->linkTarget ? st->linkTarget : "");
+        if (length >= (int)sizeof(line)) length = (int)sizeof(line) - 1;
+        outWrite(out, line, (size_t)length);
+    }
+
+    for (size_t i = 0; i < count; i++) free(stats[i].linkTarget);
+    free(stats);
+    freeIdNames(&users);
+    freeIdNames(&groups);
+}
+
+
+void revealPrintLong(const struct reveal_listing* listing, const char* dirPath){
+    int dirFd = open(dirPath, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd < 0) return;
+    struct out_buffer out;
+    if (outInit(&out, STDOUT_FILENO)) {
+        revealFormatLong(&out, dirFd, listing->entries, listing->count, true, true);
+        outFree(&out);
+    }
+    close(dirFd);
+}
+
+void revealPrintLongFile(const char* path){
+    struct reveal_entry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.name = path;
+    struct out_buffer out;
+    if (outInit(&out, STDOUT_FILENO)) {
+        revealFormatLong(&out, AT_FDCWD, &entry, 1, false, false);
+        outFree(&out);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,295 @@
+#define _GNU_SOURCE // DT_DIR, DT_UNKNOWN
+#include "../include/reveal.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+struct walk_node{
+    const char* path;             // in the arena of the walker that found it
+    struct walk_node** children;  // subdirectories, sorted
+    size_t childCount;
+    int thread;                   // walker whose buffer holds the output
+    size_t offset;                // header and listing in that buffer
+    size_t length;
+    int error;                    // errno if the directory could not be read
+};
+
+// Owner pushes and pops at bottom, thieves take from top
+struct walk_deque{
+    pthread_mutex_t lock;
+    struct walk_node** items;
+    size_t top;
+    size_t bottom;
+    size_t capacity;
+};
+
+struct walker;
+
+struct walk_thread{
+    struct walker* walker;
+    int id;
+    pthread_t handle;
+    bool started;
+    struct walk_deque deque;
+    struct arena arena;    // nodes, paths and child arrays found by this walker
+    struct out_buffer out; // in-memory
+};
+
+struct walker{
+    struct walk_thread* threads;
+    int threadCount;
+    bool all;
+    bool longFormat;
+    size_t pending;        // directories pushed but not yet read; atomic
+    pthread_mutex_t idleLock;
+    pthread_cond_t idleCond;
+    unsigned long generation; // bumped (under idleLock) whenever work is pushed or the walk ends
+};
+
+
+static bool pushNodes(struct walk_deque* deque, struct walk_node** nodes, size_t count){
+    pthread_mutex_lock(&deque->lock);
+    if (deque->top == deque->bottom) deque->top = deque->bottom = 0;
+    if (deque->bottom + count > deque->capacity) {
+        size_t newCapacity = deque->capacity ? deque->capacity : 64;
+        while (deque->bottom + count > newCapacity) newCapacity *= 2;
+        struct walk_node** grown = (struct walk_node**)realloc(deque->items, newCapacity * sizeof(struct walk_node*));
+        if (grown == NULL) {
+            pthread_mutex_unlock(&deque->lock);
+            perror("realloc failed");
+            return false;
+        }
+        deque->items = grown;
+        deque->capacity = newCapacity;
+    }
+    // Last child on the bottom: the owner pops them in reverse, thieves take the first ones
+    for (size_t i = 0; i < count; i++) deque->items[deque->bottom++] = nodes[i];
+    pthread_mutex_unlock(&deque->lock);
+    return true;
+}
+
+static struct walk_node* popBottom(struct walk_deque* deque){
+    struct walk_node* node = NULL;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom > deque->top) node = deque->items[--deque->bottom];
+    pthread_mutex_unlock(&deque->lock);
+    return node;
+}
+
+static struct walk_node* stealTop(struct walk_deque* deque){
+    struct walk_node* node = NULL;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom > deque->top) node = deque->items[deque->top++];
+    pthread_mutex_unlock(&deque->lock);
+    return node;
+}
+
+static void wakeWalkers(struct walker* walker){
+    pthread_mutex_lock(&walker->idleLock);
+    walker->generation++;
+    pthread_cond_broadcast(&walker->idleCond);
+    pthread_mutex_unlock(&walker->idleLock);
+}
+
+// Own deque first, then steal; sleep while every deque is empty but directories
+// are still being read (they may push more). NULL once the walk is over.
+static struct walk_node* findWork(struct walk_thread* self){
+    struct walker* walker = self->walker;
+    while (1) {
+        pthread_mutex_lock(&walker->idleLock);
+        unsigned long generation = walker->generation;
+        pthread_mutex_unlock(&walker->idleLock);
+
+        struct walk_node* node = popBottom(&self->deque);
+        for (int i = 1; node == NULL && i < walker->threadCount; i++) {
+            node = stealTop(&walker->threads[(self->id + i) % walker->threadCount].deque);
+        }
+        if (node != NULL) return node;
+
+        pthread_mutex_lock(&walker->idleLock);
+        bool done = __atomic_load_n(&walker->pending, __ATOMIC_ACQUIRE) == 0;
+        // Nothing pushed since the scan started: wait for the next push or the end
+        while (!done && walker->generation == generation) {
+            pthread_cond_wait(&walker->idleCond, &walker->idleLock);
+            done = __atomic_load_n(&walker->pending, __ATOMIC_ACQUIRE) == 0;
+        }
+        pthread_mutex_unlock(&walker->idleLock);
+        if (done) return NULL;
+    }
+}
+
+static char* childPath(struct arena* arena, const char* parent, const char* name){
+    size_t parentLength = strlen(parent), nameLength = strlen(name);
+    bool slash = parentLength > 0 && parent[parentLength - 1] != '/';
+    char* path = (char*)arenaAlloc(arena, parentLength + slash + nameLength + 1);
+    if (path == NULL) return NULL;
+    memcpy(path, parent, parentLength);
+    if (slash) path[parentLength] = '/';
+    memcpy(path + parentLength + slash, name, nameLength + 1);
+    return path;
+}
+
+// Read, sort and format one directory; queue its subdirectories
+static void visit(struct walk_thread* self, struct walk_node* node){
+    struct walker* walker = self->walker;
+    struct out_buffer* out = &self->out;
+    node->thread = self->id;
+    node->offset = out->len;
+    outString(out, node->path);
+    outWrite(out, ":\n", 2);
+
+    struct reveal_listing listing;
+    if (!revealCollect(&listing, node->path, walker->all)) {
+        node->error = errno ? errno : EIO;
+        node->length = out->len - node->offset;
+        return;
+    }
+    revealSort(listing.entries, listing.count);
+    if (walker->longFormat) {
+        int dirFd = open(node->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (dirFd >= 0) {
+            // The walk already keeps every core busy: no stat pool per directory
+            revealFormatLong(out, dirFd, listing.entries, listing.count, true, false);
+            close(dirFd);
+        }
+    } else if (listing.count > 0) {
+        revealFormat(out, &listing, false);
+    }
+    node->length = out->len - node->offset;
+
+    size_t candidates = 0;
+    for (size_t i = 0; i < listing.count; i++) {
+        if (listing.entries[i].type == DT_DIR || listing.entries[i].type == DT_UNKNOWN) candidates++;
+    }
+    node->children = (struct walk_node**)arenaAlloc(&self->arena, (candidates ? candidates : 1) * sizeof(struct walk_node*));
+    for (size_t i = 0; node->children != NULL && i < listing.count; i++) {
+        const struct reveal_entry* entry = &listing.entries[i];
+        if (entry->type != DT_DIR && entry->type != DT_UNKNOWN) continue;
+        if (strcmp(entry->name, ".") == 0 || strcmp(entry->name, "..") == 0) continue;
+        char* path = childPath(&self->arena, node->path, entry->name);
+        if (path == NULL) break;
+        struct stat st;
+        if (entry->type == DT_UNKNOWN && (lstat(path, &st) != 0 || !S_ISDIR(st.st_mode))) continue;
+
+        struct walk_node* child = (struct walk_node*)arenaCalloc(&self->arena, sizeof(struct walk_node));
+        if (child == NULL) break;
+        child->path = path;
+        node->children[node->childCount++] = child;
+    }
+    revealFree(&listing);
+
+    if (node->childCount > 0) {
+        __atomic_add_fetch(&walker->pending, node->childCount, __ATOMIC_ACQ_REL);
+        if (pushNodes(&self->deque, node->children, node->childCount)) {
+            wakeWalkers(walker);
+        } else {
+            __atomic_sub_fetch(&walker->pending, node->childCount, __ATOMIC_ACQ_REL);
+            node->childCount = 0;
+        }
+    }
+}
+
+static void* walkThread(void* arg){
+    struct walk_thread* self = (struct walk_thread*)arg;
+    struct walker* walker = self->walker;
+    struct walk_node* node;
+    while ((node = findWork(self)) != NULL) {
+        visit(self, node);
+        if (__atomic_sub_fetch(&walker->pending, 1, __ATOMIC_ACQ_REL) == 0) wakeWalkers(walker);
+    }
+    return NULL;
+}
+
+// Depth first, children in name order, a blank line between directories
+static void writeTree(struct walker* walker, struct walk_node* root){
+    struct out_buffer out;
+    if (!outInit(&out, STDOUT_FILENO)) return;
+    size_t stackCount = 0, stackCapacity = 64;
+    struct walk_node** stack = (struct walk_node**)malloc(stackCapacity * sizeof(struct walk_node*));
+    if (stack != NULL) stack[stackCount++] = root;
+
+    bool first = true;
+    while (stackCount > 0) {
+        struct walk_node* node = stack[--stackCount];
+        if (!first) outWrite(&out, "\n", 1);
+        first = false;
+        outWrite(&out, walker->threads[node->thread].out.buf + node->offset, node->length);
+        if (node->error != 0) {
+            outFlush(&out);
+            fprintf(stderr, "reveal: cannot open directory '%s': %s\n", node->path, strerror(node->error));
+        }
+
+        if (stackCount + node->childCount > stackCapacity) {
+            while (stackCount + node->childCount > stackCapacity) stackCapacity *= 2;
+            struct walk_node** grown = (struct walk_node**)realloc(stack, stackCapacity * sizeof(struct walk_node*));
+            if (grown == NULL) {
+                perror("realloc failed");
+                break;
+            }
+            stack = grown;
+        }
+        for (size_t i = node->childCount; i > 0; i--) stack[stackCount++] = node->children[i - 1];
+    }
+    free(stack);
+    outFree(&out);
+}
+
+
+void revealWalk(const char* dirPath, bool all, bool longFormat){
+    struct walker walker;
+    memset(&walker, 0, sizeof(walker));
+    walker.all = all;
+    walker.longFormat = longFormat;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    walker.threadCount = (cores < 1) ? 1 : (cores > REVEAL_WALK_MAX_THREADS) ? REVEAL_WALK_MAX_THREADS : (int)cores;
+    walker.threads = (struct walk_thread*)calloc((size_t)walker.threadCount, sizeof(struct walk_thread));
+    if (walker.threads == NULL) {
+        perror("calloc failed");
+        return;
+    }
+    pthread_mutex_init(&walker.idleLock, NULL);
+    pthread_cond_init(&walker.idleCond, NULL);
+
+    bool ok = true;
+    for (int i = 0; i < walker.threadCount; i++) {
+        struct walk_thread* thread = &walker.threads[i];
+        thread->walker = &walker;
+        thread->id = i;
+        pthread_mutex_init(&thread->deque.lock, NULL);
+        arenaInit(&thread->arena, 0);
+        if (!outInitMemory(&thread->out)) ok = false;
+    }
+
+    struct walk_node root;
+    memset(&root, 0, sizeof(root));
+    root.path = dirPath;
+    struct walk_node* rootNode = &root;
+    walker.pending = 1;
+    ok = ok && pushNodes(&walker.threads[0].deque, &rootNode, 1);
+
+    if (ok) {
+        // This thread is walker 0; one that fails to start just leaves its deque empty
+        for (int i = 1; i < walker.threadCount; i++) {
+            walker.threads[i].started = pthread_create(&walker.threads[i].handle, NULL, walkThread, &walker.threads[i]) == 0;
+        }
+        walkThread(&walker.threads[0]);
+        for (int i = 1; i < walker.threadCount; i++) {
+            if (walker.threads[i].started) pthread_join(walker.threads[i].handle, NULL);
+        }
+        // An unreadable top directory stays silent, as plain reveal does
+        if (root.error == 0) writeTree(&walker, &root);
+    }
+
+    for (int i = 0; i < walker.threadCount; i++) {
+        struct walk_thread* thread = &walker.threads[i];
+        free(thread->deque.items);
+        pthread_mutex_destroy(&thread->deque.lock);
+        arenaDestroy(&thread->arena);
+        free(thread->out.buf);
+    }
+    free(walker.threads);
+    pthread_mutex_destroy(&walker.idleLock);
+    pthread_cond_destroy(&walker.idleCond);
+}
\ No newline at end of file
@@ -0,0 +1,150 @@
+#include "../include/runner.h"
+#include "../include/parser.h"
+#include "../include/partB.h"
+#include "../include/executes.h"
+#include "../include/parsecache.h"
+#include <errno.h>
+
+
+bool readerInit(struct line_reader* reader, int fd){
+    memset(reader, 0, sizeof(struct line_reader));
+    reader->fd = fd;
+    reader->size = READER_CHUNK_SIZE + 1;
+    reader->buf = (char*)malloc(reader->size);
+    if (reader->buf == NULL) {
+        perror("malloc failed");
+        return false;
+    }
+    return true;
+}
+
+void readerFree(struct line_reader* reader){
+    free(reader->buf);
+    reader->buf = NULL;
+}
+
+// Move the unconsumed tail to the front, grow if a whole chunk no longer fits, then read once
+static bool readerFill(struct line_reader* reader){
+    if (reader->start > 0) {
+        memmove(reader->buf, reader->buf + reader->start, reader->end - reader->start);
+        reader->end -= reader->start;
+        reader->start = 0;
+    }
+    if (reader->size - reader->end < READER_CHUNK_SIZE + 1) {
+        size_t newSize = reader->size * 2;
+        char* newBuf = (char*)realloc(reader->buf, newSize);
+        if (newBuf == NULL) {
+            perror("realloc failed");
+            return false;
+        }
+        reader->buf = newBuf;
+        reader->size = newSize;
+    }
+
+    ssize_t got;
+    do {
+        got = read(reader->fd, reader->buf + reader->end, reader->size - reader->end - 1);
+    } while (got < 0 && errno == EINTR);
+    if (got < 0) {
+        perror("read failed");
+        return false;
+    }
+    if (got == 0) reader->eof = true;
+    reader->end += (size_t)got;
+    return true;
+}
+
+char* readerPeekLine(struct line_reader* reader){
+    if (reader->peeked) return reader->buf + reader->start;
+    char* newline = memchr(reader->buf + reader->start, '\n', reader->end - reader->start);
+    if (newline == NULL) return NULL;
+    *newline = '\0';
+    reader->peekEnd = (size_t)(newline - reader->buf);
+    reader->peeked = true;
+    return reader->buf + reader->start;
+}
+
+char* readerNextLine(struct line_reader* reader){
+    while (1) {
+        char* line = readerPeekLine(reader);
+        if (line != NULL) {
+            reader->start = reader->peekEnd + 1;
+            reader->peeked = false;
+            return line;
+        }
+        if (reader->eof) {
+            if (reader->start == reader->end) return NULL;
+            // Unterminated last line; readerFill always leaves a spare byte for this
+            line = reader->buf + reader->start;
+            reader->buf[reader->end] = '\0';
+            reader->start = reader->end;
+            return line;
+        }
+        if (!readerFill(reader)) return NULL;
+    }
+}
+
+
+void runInputLine(char* input){
+    statsBegin(STATS_DISPATCH);
+    statsCount(STATS_LINES);
+    // Verify and compile user command (cached plans for lines seen before):
+    struct plan* plan = cachedCompileCommand(input);
+    if (plan == NULL){
+        arenaReset(&parseArena);
+        return;
+    }
+
+    // Add to log if not duplicate of last executed command and not log command
+    const char* lastLogged = historyEntry(1);
+    uint64_t logged = HISTORY_NO_SEQ;
+    if ((lastLogged == NULL || strcmp(input, lastLogged) != 0) && strstr(input, "log") == NULL) {
+        addLog(input);
+        logged = historyLastPushed();
+    }
+
+    // Process user command; what it cost goes next to its log entry (see usage.h)
+    usageLineBegin();
+    executeShellCommand(plan);
+    usageLineEnd(logged);
+    statsTick();
+
+    // Release the parse arena (including any nested log execute parses) at once;
+    // the plan itself is owned by the parse cache
+    arenaReset(&parseArena);
+}
+
+
+static struct line_reader* batchReader = NULL;
+static bool nextLinePrepared = false;
+
+// foregroundWaitHook: while a child runs, compile the next line if it is already buffered.
+// Never reads, so the child keeps whatever part of the input it has not been handed yet.
+static void prepareNextLine(void){
+    if (nextLinePrepared || batchReader == NULL) return;
+    char* next = readerPeekLine(batchReader);
+    if (next == NULL) return;
+    nextLinePrepared = true;
+    if (next[0] != '\0') prepareCommand(next);
+}
+
+void runBatch(int fd){
+    struct line_reader reader;
+    if (!readerInit(&reader, fd)) return;
+    batchReader = &reader;
+    foregroundWaitHook = prepareNextLine;
+
+    char* line;
+    while ((line = readerNextLine(&reader)) != NULL) {
+        nextLinePrepared = false;
+        // Only worth a reap while background jobs exist or messages are waiting
+        if (job_list != NULL || jobNotificationsPending()) check_bg_jobs();
+        if (line[0] == '\0') continue; // Skip empty input
+        runInputLine(line);
+    }
+    if (job_list != NULL || jobNotificationsPending()) check_bg_jobs();
+
+    foregroundWaitHook = NULL;
+    batchReader = NULL;
+    readerFree(&reader);
+}
\ No newline at end of file
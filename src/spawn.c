@@ -0,0 +1,207 @@
+#include "../include/spawn.h"
+#include "../include/reaper.h"
+#include "../include/stats.h"
+#include "../include/zygote.h"
+#include <spawn.h>
+#include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/wait.h>
+
+extern char** environ;
+
+int launchBackend = LAUNCH_SPAWN;
+
+
+int redirFlags(const struct redir* r){
+    return (r->mode == REDIR_READ) ? O_RDONLY
+         : (r->mode == REDIR_APPEND) ? (O_WRONLY | O_CREAT | O_APPEND)
+         : (O_WRONLY | O_CREAT | O_TRUNC);
+}
+
+int openRedirTarget(const struct redir* r){
+    return open(r->filename, redirFlags(r) | O_CLOEXEC, 0644);
+}
+
+static void setJobSignals(posix_spawnattr_t* attr){
+    sigset_t defaults;
+    sigemptyset(&defaults);
+    sigaddset(&defaults, SIGINT);
+    sigaddset(&defaults, SIGTSTP);
+    sigaddset(&defaults, SIGTTIN);
+    sigaddset(&defaults, SIGTTOU);
+    posix_spawnattr_setsigdefault(attr, &defaults);
+
+    sigset_t none;
+    sigemptyset(&none);
+    posix_spawnattr_setsigmask(attr, &none);
+}
+
+// posix_spawn with the file actions and attributes described at spawnStage; the error number or 0
+static int spawnDirect(const struct plan_node* stage, const char* path, int inFd, int outFd, pid_t pgid,
+                       const int* closeFds, int closeCount, pid_t* pid){
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    if (inFd >= 0) posix_spawn_file_actions_adddup2(&actions, inFd, STDIN_FILENO);
+    if (outFd >= 0) posix_spawn_file_actions_adddup2(&actions, outFd, STDOUT_FILENO);
+    for (int i = 0; i < closeCount; i++) {
+        if (closeFds[i] > STDERR_FILENO) posix_spawn_file_actions_addclose(&actions, closeFds[i]);
+    }
+    // Redirections are opened by the child itself, straight onto their target fd
+    for (int i = 0; i < stage->redirCount; i++) {
+        const struct redir* r = &stage->redirs[i];
+        posix_spawn_file_actions_addopen(&actions, r->target_fd, r->filename, redirFlags(r), 0644);
+    }
+
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK);
+    posix_spawnattr_setpgroup(&attr, pgid);
+    setJobSignals(&attr);
+
+    int err = posix_spawn(pid, path, &actions, &attr, stage->argv, environ);
+    if (err == ENOEXEC) {
+        // Not a binary and no #! line: run it with /bin/sh, as execvp does
+        char* shellArgv[stage->argc + 2];
+        shellArgv[0] = "/bin/sh";
+        shellArgv[1] = (char*)path;
+        memcpy(shellArgv + 2, stage->argv + 1, (size_t)stage->argc * sizeof(char*)); // argv[1..argc], NULL
+        err = posix_spawn(pid, "/bin/sh", &actions, &attr, shellArgv, environ);
+    }
+
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    return err;
+}
+
+
+// A launch failed with err. The child opens the redirections before it execs and posix_spawn
+// reports either with the same errno, so open them here to tell which step failed
+// (error path only: the child has already created or truncated them anyway).
+static void reportFailure(const struct plan_node* stage, int err){
+    for (int i = 0; i < stage->redirCount; i++) {
+        int fd = openRedirTarget(&stage->redirs[i]);
+        if (fd < 0) {
+            perror("");
+            return;
+        }
+        close(fd);
+    }
+    if (err == ENOENT) fprintf(stderr, "Command not found!\n");
+    else fprintf(stderr, "%s: %s\n", stage->argv[0], strerror(err));
+}
+
+pid_t spawnStage(const struct plan_node* stage, int inFd, int outFd, pid_t pgid,
+                 const int* closeFds, int closeCount){
+    // Resolved once in the shell, so the child does not walk PATH with failing execve calls
+    const char* path = resolveCommand(stage->argv[0]);
+    if (path == NULL) {
+        // The targets are still created or reported, as the fork path would
+        reportFailure(stage, ENOENT);
+        return -1;
+    }
+
+    pid_t pid = -1;
+    int err;
+    uint64_t start = statsNow();
+    if (!(launchBackend == LAUNCH_ZYGOTE && zygoteSpawn(stage, path, inFd, outFd, pgid, &pid, &err))) {
+        err = spawnDirect(stage, path, inFd, outFd, pgid, closeFds, closeCount, &pid);
+    }
+    if (err != 0) {
+        reportFailure(stage, err);
+        return -1;
+    }
+    statsRecord(STATS_LAUNCH, start);
+    return pid;
+}
+
+
+static double elapsedMicros(const struct timespec* from, const struct timespec* to){
+    return (to->tv_sec - from->tv_sec) * 1e6 + (to->tv_nsec - from->tv_nsec) / 1e3;
+}
+
+// Launch latency of one backend: start and reap "true" count times, mean in microseconds
+static double benchBackend(int backend, int count){
+    char* argv[] = { "true", NULL };
+    struct plan_node stage;
+    memset(&stage, 0, sizeof(stage));
+    stage.op = OP_STAGE;
+    stage.argc = 1;
+    stage.argv = argv;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < count; i++) {
+        pid_t pid;
+        if (backend != LAUNCH_FORK) {
+            int saved = launchBackend;
+            launchBackend = backend;
+            pid = spawnStage(&stage, -1, -1, 0, NULL, 0);
+            launchBackend = saved;
+        } else {
+            // Same child setup as executeAtomicCmd's fork path
+            pid = fork();
+            if (pid == 0) {
+                reaperChildInit();
+                setpgid(0, 0);
+                signal(SIGINT, SIG_DFL);
+                signal(SIGTSTP, SIG_DFL);
+                signal(SIGTTIN, SIG_DFL);
+                signal(SIGTTOU, SIG_DFL);
+                execvp(argv[0], argv);
+                _exit(1);
+            }
+        }
+        if (pid < 0) return -1;
+        int status;
+        reaperWaitPids(&pid, 1, &status);
+        // A zygote child takes the terminal as a foreground job would
+        if (isatty(STDIN_FILENO)) tcsetpgrp(STDIN_FILENO, getpgrp());
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return elapsedMicros(&start, &end) / count;
+}
+
+void executeLaunch(int argc, char** argv){
+    if (argc == 1) {
+        printf("launch backend: %s\n", launchBackend == LAUNCH_ZYGOTE ? "zygote"
+                                      : launchBackend == LAUNCH_SPAWN ? "spawn" : "fork");
+        return;
+    }
+    if (argc == 2 && strcmp(argv[1], "fork") == 0) {
+        launchBackend = LAUNCH_FORK;
+        return;
+    }
+    if (argc == 2 && strcmp(argv[1], "spawn") == 0) {
+        launchBackend = LAUNCH_SPAWN;
+        return;
+    }
+    if (argc == 2 && strcmp(argv[1], "zygote") == 0) {
+        if (!zygoteRunning()) {
+            fprintf(stderr, "launch: zygote not running (start the shell with SHELL_ZYGOTE=1)\n");
+            return;
+        }
+        launchBackend = LAUNCH_ZYGOTE;
+        return;
+    }
+    if ((argc == 2 || argc == 3) && strcmp(argv[1], "bench") == 0) {
+        long count = 200;
+        if (argc == 3) {
+            char* end = NULL;
+            count = strtol(argv[2], &end, 10);
+            if (end == argv[2] || *end != '\0' || count <= 0) {
+                fprintf(stderr, "Invalid syntax!\n");
+                return;
+            }
+        }
+        fflush(stdout); // forked children must not inherit buffered output
+        double forkMicros = benchBackend(LAUNCH_FORK, (int)count);
+        double spawnMicros = benchBackend(LAUNCH_SPAWN, (int)count);
+        printf("fork:  %.1f us per launch\n", forkMicros);
+        printf("spawn: %.1f us per launch\n", spawnMicros);
+        if (zygoteRunning()) printf("zygote: %.1f us per launch\n", benchBackend(LAUNCH_ZYGOTE, (int)count));
+        return;
+    }
+    fprintf(stderr, "Invalid syntax!\n");
+}
\ No newline at end of file
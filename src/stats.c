@@ -0,0 +1,165 @@
+#include "../include/stats.h"
+#include "../include/cwd.h"
+#include <errno.h>
+#include <unistd.h>
+
+static const char* histogramNames[STATS_HISTOGRAMS] = { "parse", "launch", "jobs", "history", "dispatch", "prompt" };
+static const char* counterNames[STATS_COUNTERS] = { "lines", "jobs_finished" };
+
+static struct stats_histogram_data histograms[STATS_HISTOGRAMS];
+static uint64_t counters[STATS_COUNTERS];
+
+static char* exportPath = NULL;
+static int exportSeconds = STATS_EXPORT_SECONDS;
+static time_t lastExport = 0;
+
+
+uint64_t statsNow(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+void statsRecord(enum stats_histogram id, uint64_t start){
+    uint64_t nanos = statsNow() - start;
+    struct stats_histogram_data* h = &histograms[id];
+    int bucket = nanos ? 63 - __builtin_clzll(nanos) : 0;
+    if (bucket >= STATS_BUCKETS) bucket = STATS_BUCKETS - 1;
+    h->buckets[bucket]++;
+    h->count++;
+    h->totalNanos += nanos;
+    if (nanos > h->maxNanos) h->maxNanos = nanos;
+}
+
+void statsBegin(enum stats_histogram id){
+    histograms[id].pendingStart = statsNow();
+}
+
+void statsEnd(enum stats_histogram id){
+    if (histograms[id].pendingStart == 0) return;
+    statsRecord(id, histograms[id].pendingStart);
+    histograms[id].pendingStart = 0;
+}
+
+void statsCount(enum stats_counter id){
+    counters[id]++;
+}
+
+
+// Upper bound of the bucket holding the q-quantile, never above the largest sample
+static uint64_t percentile(const struct stats_histogram_data* h, double q){
+    if (h->count == 0) return 0;
+    uint64_t rank = (uint64_t)(q * h->count + 0.999999);
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < STATS_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen < rank) continue;
+        uint64_t bound = (i + 1 < 64) ? (1ull << (i + 1)) : UINT64_MAX;
+        return bound < h->maxNanos ? bound : h->maxNanos;
+    }
+    return h->maxNanos;
+}
+
+static void printStats(void){
+    printf("%-9s %9s %10s %10s %10s %10s %10s\n", "probe", "count", "mean_us", "p50_us", "p90_us", "p99_us", "max_us");
+    for (int i = 0; i < STATS_HISTOGRAMS; i++) {
+        const struct stats_histogram_data* h = &histograms[i];
+        printf("%-9s %9llu %10.1f %10.1f %10.1f %10.1f %10.1f\n", histogramNames[i], (unsigned long long)h->count,
+               h->count ? h->totalNanos / 1e3 / h->count : 0.0, percentile(h, 0.5) / 1e3,
+               percentile(h, 0.9) / 1e3, percentile(h, 0.99) / 1e3, h->maxNanos / 1e3);
+    }
+    for (int i = 0; i < STATS_COUNTERS; i++) {
+        printf("%-14s %llu\n", counterNames[i], (unsigned long long)counters[i]);
+    }
+}
+
+static bool writeExport(const char* path){
+    size_t tmpLen = strlen(path) + strlen(".tmp") + 1;
+    char* tmpPath = (char*)malloc(tmpLen);
+    if (tmpPath == NULL) return false;
+    snprintf(tmpPath, tmpLen, "%s.tmp", path);
+    FILE* file = fopen(tmpPath, "w");
+    if (file == NULL) {
+        free(tmpPath);
+        return false;
+    }
+
+    fprintf(file, "{\"time\":%lld,\"pid\":%d,\"bucket_unit\":\"log2_ns\",\"histograms\":{",
+            (long long)time(NULL), (int)getpid());
+    for (int i = 0; i < STATS_HISTOGRAMS; i++) {
+        const struct stats_histogram_data* h = &histograms[i];
+        fprintf(file, "%s\"%s\":{\"count\":%llu,\"sum_ns\":%llu,\"max_ns\":%llu,\"buckets\":[", i ? "," : "",
+                histogramNames[i], (unsigned long long)h->count, (unsigned long long)h->totalNanos,
+                (unsigned long long)h->maxNanos);
+        for (int b = 0; b < STATS_BUCKETS; b++) fprintf(file, "%s%llu", b ? "," : "", (unsigned long long)h->buckets[b]);
+        fprintf(file, "]}");
+    }
+    fprintf(file, "},\"counters\":{");
+    for (int i = 0; i < STATS_COUNTERS; i++) {
+        fprintf(file, "%s\"%s\":%llu", i ? "," : "", counterNames[i], (unsigned long long)counters[i]);
+    }
+    fprintf(file, "}}\n");
+
+    bool ok = !ferror(file);
+    ok = (fclose(file) == 0) && ok;
+    ok = ok && rename(tmpPath, path) == 0;
+    if (!ok) unlink(tmpPath);
+    free(tmpPath);
+    return ok;
+}
+
+void statsTick(void){
+    if (exportPath == NULL) return;
+    time_t now = time(NULL);
+    if (now - lastExport < exportSeconds) return;
+    lastExport = now;
+    if (!writeExport(exportPath)) {
+        fprintf(stderr, "stats: cannot write %s: %s\n", exportPath, strerror(errno));
+        free(exportPath);
+        exportPath = NULL;
+    }
+}
+
+int statsTickTimeout(void){
+    if (exportPath == NULL) return -1;
+    time_t remaining = exportSeconds - (time(NULL) - lastExport);
+    // At least a second: with a 0 interval an idle shell has little new to write
+    return (remaining < 1) ? 1000 : (int)remaining * 1000;
+}
+
+
+void executeStats(int argc, char** argv){
+    if (argc == 1) {
+        printStats();
+    } else if (argc == 2 && strcmp(argv[1], "reset") == 0) {
+        memset(histograms, 0, sizeof(histograms));
+        memset(counters, 0, sizeof(counters));
+    } else if (argc == 3 && strcmp(argv[1], "export") == 0 && strcmp(argv[2], "off") == 0) {
+        free(exportPath);
+        exportPath = NULL;
+    } else if ((argc == 3 || argc == 4) && strcmp(argv[1], "export") == 0) {
+        long seconds = STATS_EXPORT_SECONDS;
+        if (argc == 4) {
+            char* end = NULL;
+            seconds = strtol(argv[3], &end, 10);
+            if (end == argv[3] || *end != '\0' || seconds < 0) {
+                fprintf(stderr, "Invalid syntax!\n");
+                return;
+            }
+        }
+        free(exportPath);
+        // Relative to where the shell is now, not wherever it is when the export happens
+        if (argv[2][0] == '/') {
+            exportPath = strdup(argv[2]);
+        } else {
+            size_t length = strlen(currentWD) + 1 + strlen(argv[2]) + 1;
+            exportPath = (char*)malloc(length);
+            if (exportPath != NULL) snprintf(exportPath, length, "%s/%s", currentWD, argv[2]);
+        }
+        exportSeconds = (int)seconds;
+        lastExport = 0; // first snapshot right after this line
+    } else {
+        fprintf(stderr, "Invalid syntax!\n");
+    }
+}
\ No newline at end of file
@@ -0,0 +1,165 @@
+#include "../include/usage.h"
+#include "../include/history.h"
+
+bool timingAlways = false;
+
+static struct history_usage lineTotal; // this input line so far
+
+
+static double seconds(const struct timeval* tv){
+    return tv->tv_sec + tv->tv_usec / 1e6;
+}
+
+static uint64_t micros(const struct timeval* tv){
+    return (uint64_t)tv->tv_sec * 1000000u + (uint64_t)tv->tv_usec;
+}
+
+static double elapsed(const struct timespec* from, const struct timespec* to){
+    return (to->tv_sec - from->tv_sec) + (to->tv_nsec - from->tv_nsec) / 1e9;
+}
+
+static void addTime(struct timeval* sum, const struct timeval* add, int sign){
+    long usec = sum->tv_usec + sign * add->tv_usec;
+    sum->tv_sec += sign * add->tv_sec + usec / 1000000;
+    sum->tv_usec = usec % 1000000;
+    if (sum->tv_usec < 0) {
+        sum->tv_usec += 1000000;
+        sum->tv_sec--;
+    }
+}
+
+// sum += sign * add for everything but maxrss, which is the larger of the two
+static void addUsage(struct rusage* sum, const struct rusage* add, int sign){
+    addTime(&sum->ru_utime, &add->ru_utime, sign);
+    addTime(&sum->ru_stime, &add->ru_stime, sign);
+    if (add->ru_maxrss > sum->ru_maxrss) sum->ru_maxrss = add->ru_maxrss;
+    sum->ru_nvcsw += sign * add->ru_nvcsw;
+    sum->ru_nivcsw += sign * add->ru_nivcsw;
+    sum->ru_minflt += sign * add->ru_minflt;
+    sum->ru_majflt += sign * add->ru_majflt;
+}
+
+
+void usageStart(struct stage_usage* usage){
+    memset(usage, 0, sizeof(*usage));
+    clock_gettime(CLOCK_MONOTONIC, &usage->start);
+}
+
+void usageFinish(struct stage_usage* usage, const struct rusage* ru){
+    clock_gettime(CLOCK_MONOTONIC, &usage->end);
+    usage->ru = *ru;
+    usage->measured = true;
+}
+
+static void shellUsage(struct rusage* out){
+    struct rusage children;
+    getrusage(RUSAGE_SELF, out);
+    getrusage(RUSAGE_CHILDREN, &children);
+    addUsage(out, &children, 1);
+}
+
+void usageShellBegin(struct stage_usage* usage){
+    usageStart(usage);
+    shellUsage(&usage->ru);
+}
+
+void usageShellEnd(struct stage_usage* usage){
+    struct rusage now;
+    shellUsage(&now);
+    long maxrss = now.ru_maxrss;
+    addUsage(&now, &usage->ru, -1);
+    now.ru_maxrss = maxrss; // a high-water mark, not a counter
+    usageFinish(usage, &now);
+}
+
+
+// What a group cost: CPU and counts summed, wall from the first start to the last reap
+static bool groupTotal(const struct stage_usage* usages, int count, struct stage_usage* total){
+    memset(total, 0, sizeof(*total));
+    for (int i = 0; i < count; i++) {
+        const struct stage_usage* stage = &usages[i];
+        if (!stage->measured) continue;
+        if (!total->measured || elapsed(&stage->start, &total->start) > 0) total->start = stage->start;
+        if (!total->measured || elapsed(&total->end, &stage->end) > 0) total->end = stage->end;
+        addUsage(&total->ru, &stage->ru, 1);
+        total->measured = true;
+    }
+    return total->measured;
+}
+
+static void printRow(const struct stage_usage* usage, const char* name, int nameLength){
+    const struct rusage* ru = &usage->ru;
+    fprintf(stderr, "%9.3f %9.3f %9.3f %7ldK %6ld %6ld %7ld %6ld  %.*s\n",
+            elapsed(&usage->start, &usage->end), seconds(&ru->ru_utime), seconds(&ru->ru_stime),
+            ru->ru_maxrss, ru->ru_nvcsw, ru->ru_nivcsw, ru->ru_minflt, ru->ru_majflt, nameLength, name);
+}
+
+void usageReport(const struct plan_node* stages, const struct stage_usage* usages, int count){
+    fprintf(stderr, "     real      user       sys   maxrss    vcs   ivcs  minflt majflt  stage\n");
+    for (int i = 0; i < count; i++) {
+        if (!usages[i].measured) continue;
+        const char* name = stages[i].text ? stages[i].text : (stages[i].argc > 0 ? stages[i].argv[0] : "");
+        int nameLength = stages[i].text ? stages[i].textLength : (int)strlen(name);
+        // A stage's text view runs up to the '|' after it, blanks included
+        while (nameLength > 0 && (name[nameLength - 1] == ' ' || name[nameLength - 1] == '\t')) nameLength--;
+        printRow(&usages[i], name, nameLength);
+    }
+    struct stage_usage total;
+    if (count > 1 && groupTotal(usages, count, &total)) printRow(&total, "total", 5);
+}
+
+
+void usageLineBegin(void){
+    memset(&lineTotal, 0, sizeof(lineTotal));
+}
+
+void usageLineAdd(const struct stage_usage* usages, int count){
+    struct stage_usage total;
+    if (!groupTotal(usages, count, &total)) return;
+    // Groups of a line run one after another: their walls add up
+    for (int i = 0; i < count; i++) lineTotal.stages += usages[i].measured;
+    lineTotal.wallMicros += (uint64_t)(elapsed(&total.start, &total.end) * 1e6);
+    lineTotal.userMicros += micros(&total.ru.ru_utime);
+    lineTotal.sysMicros += micros(&total.ru.ru_stime);
+    if ((uint64_t)total.ru.ru_maxrss > lineTotal.maxRssKb) lineTotal.maxRssKb = (uint64_t)total.ru.ru_maxrss;
+    lineTotal.voluntarySwitches += (uint64_t)total.ru.ru_nvcsw;
+    lineTotal.involuntarySwitches += (uint64_t)total.ru.ru_nivcsw;
+    lineTotal.minorFaults += (uint64_t)total.ru.ru_minflt;
+    lineTotal.majorFaults += (uint64_t)total.ru.ru_majflt;
+}
+
+void usageLineEnd(uint64_t seq){
+    if (lineTotal.stages == 0 || seq == HISTORY_NO_SEQ) return;
+    historySetUsage(seq, &lineTotal);
+}
+
+
+void printLogUsage(void){
+    historyRefresh();
+    printf("     real      user       sys   maxrss  command\n");
+    uint64_t next = historyNextSeq();
+    for (uint64_t seq = historyOldestSeq(); seq < next; seq++) {
+        struct history_usage usage;
+        bool recorded = historyUsageBySeq(seq, &usage);
+        const char* entry = historyEntryBySeq(seq); // after the usage lookup, which reuses the copy
+        if (entry == NULL) continue;
+        if (recorded) {
+            printf("%9.3f %9.3f %9.3f %7lluK  %s\n", usage.wallMicros / 1e6, usage.userMicros / 1e6,
+                   usage.sysMicros / 1e6, (unsigned long long)usage.maxRssKb, entry);
+        } else {
+            printf("%9s %9s %9s %8s  %s\n", "-", "-", "-", "-", entry);
+        }
+    }
+}
+
+void executeTiming(int argc, char** argv){
+    if (argc == 1) {
+        printf("timing: %s\n", timingAlways ? "on" : "off");
+    } else if (argc == 2 && strcmp(argv[1], "on") == 0) {
+        timingAlways = true;
+    } else if (argc == 2 && strcmp(argv[1], "off") == 0) {
+        timingAlways = false;
+    } else {
+        fprintf(stderr, "Invalid syntax!\n");
+    }
+}
\ No newline at end of file
@@ -0,0 +1,282 @@
+#define _GNU_SOURCE // clone flags, O_PATH, pipe2, MSG_CMSG_CLOEXEC
+#include "../include/zygote.h"
+#include "../include/spawn.h"
+#include "../include/reaper.h"
+#include "../include/cwd.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+#define ZYGOTE_FDS 4 // stdin, stdout, stderr, cwd
+
+extern char** environ;
+
+static int zygoteFd = -1;     // the shell's end of the socket pair
+static pid_t zygoteOwner = 0; // the shell process; its forked children do not share the socket
+
+static int cwdFd = -1;        // the shell's cwd, reopened after every hop
+static unsigned long cwdFdGeneration = 0;
+
+
+// ---- The helper ----
+
+// In the new child: everything spawnStage asks of posix_spawn, then exec. Returns the errno on failure.
+static int setUpChild(const struct zygote_request* request, const struct zygote_redir* redirs,
+                      char* path, char** argv, char** filenames, const int* fds){
+    if (setpgid(0, request->pgid) != 0) return errno;
+    // Still on the zygote's stdin, with SIGTTOU ignored as in the shell
+    if (request->foreground) tcsetpgrp(STDIN_FILENO, getpid());
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTSTP, SIG_DFL);
+    signal(SIGTTIN, SIG_DFL);
+    signal(SIGTTOU, SIG_DFL);
+    sigset_t none;
+    sigemptyset(&none);
+    sigprocmask(SIG_SETMASK, &none, NULL);
+
+    if (fchdir(fds[3]) != 0) return errno;
+    for (int i = 0; i < 3; i++) {
+        if (dup2(fds[i], i) < 0) return errno;
+    }
+    for (int i = 0; i < request->redirCount; i++) {
+        int fd = open(filenames[i], redirs[i].flags, 0644);
+        if (fd < 0) return errno;
+        if (fd != redirs[i].targetFd) {
+            if (dup2(fd, redirs[i].targetFd) < 0) return errno;
+            close(fd);
+        }
+    }
+    execve(path, argv, environ);
+    if (errno == ENOEXEC) {
+        // Not a binary and no #! line: run it with /bin/sh, as execvp does
+        char* shellArgv[request->argc + 2];
+        shellArgv[0] = "/bin/sh";
+        shellArgv[1] = path;
+        memcpy(shellArgv + 2, argv + 1, (size_t)request->argc * sizeof(char*)); // argv[1..argc], NULL
+        execve("/bin/sh", shellArgv, environ);
+    }
+    return errno;
+}
+
+// fork(), except that the child's parent is the shell rather than the zygote. Raw
+// clone because the glibc wrapper wants a new stack; with no stack and no tid or tls
+// arguments only the position of flags matters, which is first everywhere but s390.
+static pid_t cloneParent(void){
+#if defined(__s390__) || defined(__CRIS__)
+    return (pid_t)syscall(SYS_clone, 0, CLONE_PARENT | SIGCHLD, 0, 0, 0);
+#else
+    return (pid_t)syscall(SYS_clone, CLONE_PARENT | SIGCHLD, 0, 0, 0, 0);
+#endif
+}
+
+// Check and unpack one request, start its child; the reply to send back
+static struct zygote_reply launch(char* buffer, size_t size, const int* fds){
+    struct zygote_reply reply = { -1, EINVAL };
+    if (size < sizeof(struct zygote_request)) return reply;
+    struct zygote_request request;
+    memcpy(&request, buffer, sizeof(request));
+    size_t tableSize = (size_t)request.redirCount * sizeof(struct zygote_redir);
+    if (request.argc < 1 || request.redirCount < 0 || sizeof(request) + tableSize > size
+        || request.length != size - sizeof(request) - tableSize) {
+        return reply;
+    }
+    struct zygote_redir* redirs = (struct zygote_redir*)(buffer + sizeof(request));
+
+    // path, argv[0..argc), filenames[0..redirCount), each '\0'-terminated
+    int stringCount = 1 + request.argc + request.redirCount;
+    char* strings[stringCount + 1];
+    char* at = buffer + sizeof(request) + tableSize;
+    char* end = buffer + size;
+    for (int i = 0; i < stringCount; i++) {
+        char* terminator = (at < end) ? memchr(at, '\0', (size_t)(end - at)) : NULL;
+        if (terminator == NULL) return reply;
+        strings[i] = at;
+        at = terminator + 1;
+    }
+    char* argv[request.argc + 1];
+    memcpy(argv, strings + 1, (size_t)request.argc * sizeof(char*));
+    argv[request.argc] = NULL;
+
+    int errPipe[2];
+    if (pipe2(errPipe, O_CLOEXEC) != 0) {
+        reply.err = errno;
+        return reply;
+    }
+    pid_t pid = cloneParent();
+    if (pid == 0) {
+        close(errPipe[0]);
+        int err = setUpChild(&request, redirs, strings[0], argv, strings + 1 + request.argc, fds);
+        while (write(errPipe[1], &err, sizeof(err)) < 0 && errno == EINTR);
+        _exit(127);
+    }
+    close(errPipe[1]);
+    reply.pid = pid;
+    reply.err = (pid < 0) ? errno : 0;
+    if (pid > 0) {
+        // Nothing comes through until the exec closes the pipe, unless a step failed
+        int err = 0;
+        ssize_t got;
+        while ((got = read(errPipe[0], &err, sizeof(err))) < 0 && errno == EINTR);
+        if (got == (ssize_t)sizeof(err)) reply.err = err;
+    }
+    close(errPipe[0]);
+    return reply;
+}
+
+static void serve(int sock){
+    static char buffer[ZYGOTE_MAX_REQUEST];
+    while (1) {
+        struct iovec iov = { buffer, sizeof(buffer) };
+        union{
+            struct cmsghdr header;
+            char space[CMSG_SPACE(ZYGOTE_FDS * sizeof(int))];
+        } control;
+        struct msghdr message;
+        memset(&message, 0, sizeof(message));
+        message.msg_iov = &iov;
+        message.msg_iovlen = 1;
+        message.msg_control = control.space;
+        message.msg_controllen = sizeof(control.space);
+
+        ssize_t got = recvmsg(sock, &message, MSG_CMSG_CLOEXEC);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) _exit(0); // the shell is gone
+
+        int fds[ZYGOTE_FDS];
+        int fdCount = 0;
+        struct cmsghdr* header = CMSG_FIRSTHDR(&message);
+        if (header != NULL && header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS) {
+            fdCount = (int)((header->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+            if (fdCount > ZYGOTE_FDS) fdCount = ZYGOTE_FDS;
+            memcpy(fds, CMSG_DATA(header), (size_t)fdCount * sizeof(int));
+        }
+
+        struct zygote_reply reply = { -1, EINVAL };
+        if (fdCount == ZYGOTE_FDS && !(message.msg_flags & (MSG_TRUNC | MSG_CTRUNC))) {
+            reply = launch(buffer, (size_t)got, fds);
+        }
+        for (int i = 0; i < fdCount; i++) close(fds[i]);
+        while (send(sock, &reply, sizeof(reply), MSG_NOSIGNAL) < 0 && errno == EINTR);
+    }
+}
+
+
+// ---- The shell's side ----
+
+bool zygoteStart(void){
+    int pair[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, pair) != 0) {
+        perror("zygote: socketpair failed");
+        return false;
+    }
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("zygote: fork failed");
+        close(pair[0]);
+        close(pair[1]);
+        return false;
+    }
+    if (pid == 0) {
+        reaperChildInit();
+        close(pair[0]);
+        serve(pair[1]);
+    }
+    close(pair[1]);
+    zygoteFd = pair[0];
+    zygoteOwner = getpid();
+    return true;
+}
+
+bool zygoteRunning(void){
+    return zygoteFd >= 0;
+}
+
+static void zygoteLost(void){
+    close(zygoteFd);
+    zygoteFd = -1;
+    if (launchBackend == LAUNCH_ZYGOTE) launchBackend = LAUNCH_SPAWN;
+    fprintf(stderr, "launch: zygote is gone, using spawn\n");
+}
+
+static int currentDirFd(void){
+    if (cwdFd >= 0 && cwdFdGeneration == cwdGeneration) return cwdFd;
+    if (cwdFd >= 0) close(cwdFd);
+    cwdFd = open(".", O_PATH | O_DIRECTORY | O_CLOEXEC);
+    cwdFdGeneration = cwdGeneration;
+    return cwdFd;
+}
+
+bool zygoteSpawn(const struct plan_node* stage, const char* path, int inFd, int outFd, pid_t pgid,
+                 pid_t* pid, int* err){
+    if (zygoteFd < 0 || getpid() != zygoteOwner) return false;
+    int dirFd = currentDirFd();
+    if (dirFd < 0) return false;
+
+    static char buffer[ZYGOTE_MAX_REQUEST];
+    // A new group started by the shell process itself is always a foreground job
+    bool foreground = pgid == 0 && isatty(STDIN_FILENO);
+    struct zygote_request request = { (int32_t)pgid, (int32_t)stage->argc, (int32_t)stage->redirCount, foreground, 0 };
+    size_t size = sizeof(request) + (size_t)stage->redirCount * sizeof(struct zygote_redir);
+    if (size > sizeof(buffer)) return false;
+    for (int i = 0; i < stage->redirCount; i++) {
+        struct zygote_redir redir = { stage->redirs[i].target_fd, redirFlags(&stage->redirs[i]) };
+        memcpy(buffer + sizeof(request) + (size_t)i * sizeof(redir), &redir, sizeof(redir));
+    }
+    size_t stringsStart = size;
+    int stringCount = 1 + stage->argc + stage->redirCount;
+    for (int i = 0; i < stringCount; i++) {
+        const char* string = (i == 0) ? path
+                           : (i <= stage->argc) ? stage->argv[i - 1]
+                           : stage->redirs[i - 1 - stage->argc].filename;
+        size_t length = strlen(string) + 1;
+        if (size + length > sizeof(buffer)) return false;
+        memcpy(buffer + size, string, length);
+        size += length;
+    }
+    request.length = (uint32_t)(size - stringsStart);
+    memcpy(buffer, &request, sizeof(request));
+
+    int fds[ZYGOTE_FDS] = { inFd >= 0 ? inFd : STDIN_FILENO, outFd >= 0 ? outFd : STDOUT_FILENO, STDERR_FILENO, dirFd };
+    union{
+        struct cmsghdr header;
+        char space[CMSG_SPACE(sizeof(fds))];
+    } control;
+    memset(&control, 0, sizeof(control));
+    struct iovec iov = { buffer, size };
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control.space;
+    message.msg_controllen = sizeof(control.space);
+    struct cmsghdr* header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(header), fds, sizeof(fds));
+
+    ssize_t sent;
+    while ((sent = sendmsg(zygoteFd, &message, MSG_NOSIGNAL)) < 0 && errno == EINTR);
+    struct zygote_reply reply;
+    ssize_t got = -1;
+    if (sent == (ssize_t)size) {
+        while ((got = recv(zygoteFd, &reply, sizeof(reply), 0)) < 0 && errno == EINTR);
+    }
+    if (got != (ssize_t)sizeof(reply)) {
+        zygoteLost();
+        return false;
+    }
+    if (reply.err != 0 && reply.pid > 0) {
+        // Cloned but never exec'd: reap it here, as posix_spawn does
+        int status;
+        while (waitpid(reply.pid, &status, 0) < 0 && errno == EINTR);
+    }
+    *pid = reply.pid;
+    *err = reply.err;
+    return true;
+}
\ No newline at end of file